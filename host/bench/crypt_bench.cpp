@@ -0,0 +1,423 @@
+#include <ntag_crypt.h>
+#include <crypto/aes128.h>
+#include <crypto/sha256.h>
+#include <crypto/amiibo_crypt.h>
+#include <coreinit/ios.h>
+#include <host/host.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/*  Checks the software amiibo crypto backend and measures its throughput.
+    The keys are generated, so no retail keys are needed. Tags encrypted
+    with them can't be read by a console, but the round trip is the same.
+    The /dev/ccr_nfc layout is compared against the shuffle functions
+    ntag_crypt used before it was generated from the section table. */
+
+#define DEFAULT_ITERATIONS 2000
+
+static uint32_t rngState = 0x12345678;
+
+static uint8_t NextRandom()
+{
+    // xorshift32, only has to be deterministic
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return (uint8_t) rngState;
+}
+
+static void FillRandom(void* data, size_t size)
+{
+    for (size_t i = 0; i < size; i++) {
+        ((uint8_t*) data)[i] = NextRandom();
+    }
+}
+
+static bool failed = false;
+
+static void Check(bool condition, const char* what)
+{
+    printf("%-40s %s\n", what, condition ? "ok" : "FAILED");
+    if (!condition) {
+        failed = true;
+    }
+}
+
+static bool ParseHex(const char* hex, uint8_t* out, size_t size)
+{
+    for (size_t i = 0; i < size; i++) {
+        unsigned int byte;
+        if (sscanf(hex + i * 2, "%2x", &byte) != 1) {
+            return false;
+        }
+        out[i] = (uint8_t) byte;
+    }
+
+    return true;
+}
+
+static bool Equals(const uint8_t* data, const char* hex, size_t size)
+{
+    uint8_t expected[64];
+    return ParseHex(hex, expected, size) && memcmp(data, expected, size) == 0;
+}
+
+// FIPS-197 C.1, SP800-38A F.5.1, FIPS 180-2 B.1 and RFC 4231 test case 1
+static void CheckPrimitives()
+{
+    uint8_t key[16];
+    uint8_t in[16];
+    uint8_t out[32];
+    Aes128Context aes;
+
+    ParseHex("000102030405060708090a0b0c0d0e0f", key, sizeof(key));
+    ParseHex("00112233445566778899aabbccddeeff", in, sizeof(in));
+    Aes128Init(&aes, key);
+    Aes128EncryptBlock(&aes, in, out);
+    Check(Equals(out, "69c4e0d86a7b0430d8cdb78070b4c55a", 16), "AES-128 block");
+
+    uint8_t iv[16];
+    ParseHex("2b7e151628aed2a6abf7158809cf4f3c", key, sizeof(key));
+    ParseHex("f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff", iv, sizeof(iv));
+    ParseHex("6bc1bee22e409f96e93d7e117393172a", in, sizeof(in));
+    Aes128Init(&aes, key);
+    Aes128Ctr(&aes, iv, in, out, sizeof(in));
+    Check(Equals(out, "874d6191b620e3261bef6864990db6ce", 16), "AES-128-CTR");
+
+    Sha256Context sha;
+    Sha256Init(&sha);
+    Sha256Update(&sha, "abc", 3);
+    Sha256Final(&sha, out);
+    Check(Equals(out, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", 32), "SHA-256");
+
+    uint8_t hmacKey[20];
+    memset(hmacKey, 0x0b, sizeof(hmacKey));
+    HmacSha256(hmacKey, sizeof(hmacKey), "Hi There", 8, out);
+    Check(Equals(out, "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7", 32), "HMAC-SHA256");
+}
+
+static void GenerateKeys(AmiiboKeys* keys)
+{
+    FillRandom(keys, sizeof(AmiiboKeys));
+
+    // Same strings and magic byte sizes as the retail keys
+    memset(keys->data.typeString, 0, sizeof(keys->data.typeString));
+    strcpy(keys->data.typeString, "unfixed infos");
+    keys->data.rfu = 0;
+    keys->data.magicBytesSize = 14;
+
+    memset(keys->tag.typeString, 0, sizeof(keys->tag.typeString));
+    strcpy(keys->tag.typeString, "locked secret");
+    keys->tag.rfu = 0;
+    keys->tag.magicBytesSize = 16;
+}
+
+// Plain tag with the lock and config bytes NTAGDecrypt expects
+static void GenerateRawTag(NTAGRawDataT2T* raw)
+{
+    FillRandom(raw, sizeof(NTAGRawDataT2T));
+
+    raw->lockBytes[0] = 0x0f;
+    raw->lockBytes[1] = 0xe0;
+    raw->section0.magic = 0xa5;
+    raw->section1.formatVersion = 2;
+    raw->dynamicLock[0] = 0x01;
+    raw->dynamicLock[1] = 0x00;
+    raw->dynamicLock[2] = 0x0f;
+    memset(raw->cfg0, 0, sizeof(raw->cfg0));
+    raw->cfg0[3] = 0x04;
+    memset(raw->cfg1, 0, sizeof(raw->cfg1));
+    raw->cfg1[0] = 0x5f;
+}
+
+static void CheckAmiiboRoundTrip(const AmiiboKeys* keys)
+{
+    uint8_t plain[AMIIBO_CRYPT_DATA_SIZE];
+    uint8_t encrypted[AMIIBO_CRYPT_DATA_SIZE];
+    uint8_t decrypted[AMIIBO_CRYPT_DATA_SIZE];
+    FillRandom(plain, sizeof(plain));
+
+    // The HMACs are generated by the encryption, so take them from there
+    AmiiboEncrypt(keys, plain, encrypted);
+    memcpy(plain + 0x008, encrypted + 0x008, 0x20);
+    memcpy(plain + 0x1b4, encrypted + 0x1b4, 0x20);
+
+    Check(memcmp(encrypted + 0x02c, plain + 0x02c, 0x188) != 0, "Amiibo encrypt changes the data");
+    Check(AmiiboDecrypt(keys, encrypted, decrypted) == 0, "Amiibo decrypt verifies the HMACs");
+    Check(memcmp(decrypted, plain, sizeof(plain)) == 0, "Amiibo round trip");
+
+    encrypted[0x100] ^= 0x01;
+    Check(AmiiboDecrypt(keys, encrypted, decrypted) != 0, "Amiibo decrypt rejects modified data");
+}
+
+static void CheckNTAGRoundTrip(NTAGCryptSession* session)
+{
+    NTAGRawDataT2T raw;
+    GenerateRawTag(&raw);
+
+    // The host's /dev/ccr_nfc doesn't encrypt, so this only converts the plain tag
+    // NTAGDecrypt doesn't fill every field, so start out with the same data on both sides
+    NTAGDataT2T data;
+    memset(&data, 0, sizeof(data));
+    NTAGRawDataT2T tmp = raw;
+    NTAGSetCryptBackend(NFPII_CRYPT_BACKEND_CCR_NFC);
+    Check(NTAGDecrypt(session, &data, &tmp) == 0, "Convert the plain tag");
+
+    NTAGSetCryptBackend(NFPII_CRYPT_BACKEND_SOFTWARE);
+
+    NTAGRawDataT2T encrypted;
+    Check(NTAGEncrypt(session, &encrypted, &data) == 0, "NTAGEncrypt with the software backend");
+    Check(memcmp(encrypted.applicationData, raw.applicationData, sizeof(raw.applicationData)) != 0, "NTAGEncrypt encrypts the app data");
+
+    NTAGDataT2T decrypted;
+    memset(&decrypted, 0, sizeof(decrypted));
+    tmp = encrypted;
+    Check(NTAGDecrypt(session, &decrypted, &tmp) == 0, "NTAGDecrypt with the software backend");
+    Check(memcmp(&decrypted.info, &data.info, sizeof(data.info)) == 0
+        && memcmp(&decrypted.appData, &data.appData, sizeof(data.appData)) == 0, "NTAG round trip");
+}
+
+// The previous hand-written shuffle, including its full struct copies
+static void RefRawDataToCryptData(NFCCryptData* raw, NFCCryptData* crypt)
+{
+    memcpy(crypt, raw, sizeof(NFCCryptData));
+    crypt->version = raw->version;
+    crypt->offsets[0] = 0x208;
+    crypt->offsets[1] = 0x29;
+    crypt->offsets[2] = 0x1e8;
+    crypt->offsets[3] = 0x1d4;
+    crypt->offsets[4] = 0x2c;
+    crypt->offsets[5] = 0x188;
+    crypt->offsets[6] = 0x1dc;
+    crypt->offsets[7] = 0x0;
+    crypt->offsets[8] = 0x8;
+    crypt->offsets[9] = 0x1b4;
+
+    uint8_t* src = (uint8_t*) raw->data;
+    uint8_t* dst = (uint8_t*) crypt->data;
+    memcpy(dst + 0x1d4, src, 0x8);
+    memcpy(dst, src + 0x8, 0x8);
+    memcpy(dst + 0x28, src + 0x10, 0x4);
+    memcpy(dst + crypt->offsets[4], src + 0x14, 0x20);
+    memcpy(dst + crypt->offsets[9], src + 0x34, 0x20);
+    memcpy(dst + crypt->offsets[6], src + 0x54, 0xc);
+    memcpy(dst + crypt->offsets[2], src + 0x60, 0x20);
+    memcpy(dst + crypt->offsets[8], src + 0x80, 0x20);
+    memcpy(dst + crypt->offsets[4] + 0x20, src + 0xa0, 0x168);
+    memcpy(dst + 0x208, src + 0x208, 0x14);
+}
+
+static void RefCryptDataToRawData(NFCCryptData* crypt, NFCCryptData* raw)
+{
+    memcpy(raw, crypt, sizeof(NFCCryptData));
+    raw->version = crypt->version;
+    raw->offsets[0] = 0x208;
+    raw->offsets[1] = 0x11;
+    raw->offsets[2] = 0x60;
+    raw->offsets[3] = 0x0;
+    raw->offsets[4] = 0x14;
+    raw->offsets[5] = 0x188;
+    raw->offsets[6] = 0x54;
+    raw->offsets[7] = 0xc;
+    raw->offsets[8] = 0x80;
+    raw->offsets[9] = 0x34;
+
+    uint8_t* src = (uint8_t*) crypt->data;
+    uint8_t* dst = (uint8_t*) raw->data;
+    memcpy(dst + 0x8, src, 0x8);
+    memcpy(dst + 0x10, src + 0x28, 0x4);
+    memcpy(dst + 0xa0, src + 0x4c, 0x168);
+    memcpy(dst + raw->offsets[8], src + 0x8, 0x20);
+    memcpy(dst + raw->offsets[4], src + 0x2c, 0x20);
+    memcpy(dst + raw->offsets[9], src + 0x1b4, 0x20);
+    memcpy(dst + raw->offsets[3], src + 0x1d4, 0x8);
+    memcpy(dst + raw->offsets[6], src + 0x1dc, 0xc);
+    memcpy(dst + raw->offsets[2], src + 0x1e8, 0x20);
+    memcpy(dst + 0x208, src + 0x208, 0x14);
+}
+
+// The previous decryptGameData with its three stack buffers
+static int RefDecryptGameData(NTAGRawDataT2T* data)
+{
+    int handle = IOS_Open("/dev/ccr_nfc", (IOSOpenMode) 0);
+    if (handle < 0) {
+        return handle;
+    }
+
+    NFCCryptData rawData;
+    rawData.version = data->section1.formatVersion;
+    memcpy(rawData.data, data, sizeof(NTAGRawDataT2T));
+
+    NFCCryptData inData;
+    RefRawDataToCryptData(&rawData, &inData);
+
+    NFCCryptData outData;
+    int res = IOS_Ioctl(handle, 2, &inData, sizeof(inData), &outData, sizeof(outData));
+    IOS_Close(handle);
+    if (res < 0) {
+        return res;
+    }
+
+    memset(&rawData, 0, sizeof(rawData));
+    RefCryptDataToRawData(&outData, &rawData);
+    memcpy(data, rawData.data, sizeof(NTAGRawDataT2T));
+    return 0;
+}
+
+// The section table is checked to be a bijection by static_asserts in ntag_crypt.cpp,
+// this makes sure it's the same one the hand-written functions used
+static void CheckLayout(NTAGCryptSession* session)
+{
+    NTAGSetCryptBackend(NFPII_CRYPT_BACKEND_CCR_NFC);
+
+    bool sameRequest = true;
+    bool sameResult = true;
+    for (int i = 0; i < 64; i++) {
+        NTAGRawDataT2T raw;
+        GenerateRawTag(&raw);
+
+        NTAGDataT2T data;
+        NTAGRawDataT2T tmp = raw;
+        NTAGDecrypt(session, &data, &tmp);
+
+        NFCCryptData request;
+        if (HostGetLastCcrNfcRequest(&request, sizeof(request)) != sizeof(request)) {
+            sameRequest = false;
+            break;
+        }
+
+        NFCCryptData rawData;
+        NFCCryptData expected;
+        rawData.version = raw.section1.formatVersion;
+        memcpy(rawData.data, &raw, sizeof(NTAGRawDataT2T));
+        RefRawDataToCryptData(&rawData, &expected);
+        sameRequest &= memcmp(&request, &expected, sizeof(request)) == 0;
+
+        // The null cipher returns the request, so the shuffle back has to restore the tag
+        RefCryptDataToRawData(&request, &rawData);
+        sameResult &= memcmp(&tmp, &raw, sizeof(raw)) == 0 && memcmp(rawData.data, &raw, sizeof(raw)) == 0;
+    }
+
+    Check(sameRequest, "ccr_nfc layout matches the old shuffle");
+    Check(sameResult, "Layout round trip");
+}
+
+template <typename Fn>
+static double MeasureUs(uint32_t iterations, Fn fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        fn();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::micro>(end - start).count() / iterations;
+}
+
+static void PrintThroughput(const char* name, double us, size_t size)
+{
+    printf("%-40s %8.2f us %8.2f MB/s\n", name, us, size / us);
+}
+
+static void MeasureThroughput(const AmiiboKeys* keys, NTAGCryptSession* session, uint32_t iterations)
+{
+    uint8_t plain[AMIIBO_CRYPT_DATA_SIZE];
+    uint8_t encrypted[AMIIBO_CRYPT_DATA_SIZE];
+    uint8_t decrypted[AMIIBO_CRYPT_DATA_SIZE];
+    FillRandom(plain, sizeof(plain));
+    AmiiboEncrypt(keys, plain, encrypted);
+
+    printf("\n%-40s %11s %13s\n", "operation", "per call", "throughput");
+
+    PrintThroughput("AmiiboEncrypt", MeasureUs(iterations, [&] {
+        AmiiboEncrypt(keys, plain, encrypted);
+    }), sizeof(plain));
+
+    PrintThroughput("AmiiboDecrypt", MeasureUs(iterations, [&] {
+        AmiiboDecrypt(keys, encrypted, decrypted);
+    }), sizeof(plain));
+
+    NTAGRawDataT2T raw;
+    GenerateRawTag(&raw);
+
+    NTAGDataT2T data;
+    NTAGRawDataT2T tmp = raw;
+    NTAGSetCryptBackend(NFPII_CRYPT_BACKEND_CCR_NFC);
+    NTAGDecrypt(session, &data, &tmp);
+
+    NTAGSetCryptBackend(NFPII_CRYPT_BACKEND_SOFTWARE);
+    NTAGRawDataT2T encryptedRaw;
+    NTAGEncrypt(session, &encryptedRaw, &data);
+
+    PrintThroughput("NTAGEncrypt (software)", MeasureUs(iterations, [&] {
+        NTAGEncrypt(session, &tmp, &data);
+    }), sizeof(NTAGRawDataT2T));
+
+    PrintThroughput("NTAGDecrypt (software)", MeasureUs(iterations, [&] {
+        tmp = encryptedRaw;
+        NTAGDecrypt(session, &data, &tmp);
+    }), sizeof(NTAGRawDataT2T));
+}
+
+// Both go through the host's /dev/ccr_nfc, so this is mostly the cost of the shuffle and its copies
+static void MeasureLayout(NTAGCryptSession* session, uint32_t iterations)
+{
+    NTAGSetCryptBackend(NFPII_CRYPT_BACKEND_CCR_NFC);
+
+    NTAGRawDataT2T raw;
+    GenerateRawTag(&raw);
+
+    NTAGDataT2T data;
+    NTAGRawDataT2T tmp;
+
+    PrintThroughput("Old decryptGameData (ccr_nfc)", MeasureUs(iterations, [&] {
+        tmp = raw;
+        RefDecryptGameData(&tmp);
+    }), sizeof(NTAGRawDataT2T));
+
+    // Includes the lock byte checks and the field conversion as well
+    PrintThroughput("NTAGDecrypt (ccr_nfc)", MeasureUs(iterations, [&] {
+        tmp = raw;
+        NTAGDecrypt(session, &data, &tmp);
+    }), sizeof(NTAGRawDataT2T));
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t iterations = DEFAULT_ITERATIONS;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iterations = strtoul(argv[++i], nullptr, 0);
+        } else {
+            fprintf(stderr, "Usage: %s [-n iterations]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    CheckPrimitives();
+
+    AmiiboKeys keys;
+    GenerateKeys(&keys);
+    Check(NTAGLoadAmiiboKeys(&keys, sizeof(keys)) == 0, "Load the generated keys");
+
+    CheckAmiiboRoundTrip(&keys);
+
+    NTAGCryptSession session;
+    NTAGInitCryptSession(&session);
+    CheckNTAGRoundTrip(&session);
+    CheckLayout(&session);
+
+    if (failed) {
+        return 1;
+    }
+
+    MeasureThroughput(&keys, &session, iterations);
+
+    MeasureLayout(&session, iterations);
+
+    NTAGCloseCryptSession(&session);
+    return 0;
+}
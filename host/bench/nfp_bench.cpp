@@ -0,0 +1,462 @@
+#include <wums.h>
+#include <nfpii.h>
+#include <nn/nfp.h>
+#include <ntag/ntag.h>
+#include <host/host.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+/*  Runs the nn::nfp call sequence of a game against the module on the host.
+    The exports are looked up by name, like the loader resolves them for games.
+    Per-call latencies are measured by the module itself (NfpiiGetCallProfile).
+    Every other session the tag is only selected after detection started,
+    so it's loaded by the loader thread and presented by the proc alarm.
+    The module runs on its virtual clock, so sessions can be played for
+    minutes (-s) without waiting for them.
+    Afterwards NFCGetTagInfo is polled like amiibo festival does, once with
+    the resident tag info and once with a tag switch before every request. */
+
+using namespace nn::nfp;
+
+#define TAG_DIR "/vol/external01/wiiu/re_nfpii"
+#define TAG_DATA_DIR "/vol/external01/wiiu/re_nfpii_data"
+#define RAW_TAG_PATH TAG_DIR "/bench.bin"
+#define SECOND_TAG_PATH TAG_DIR "/bench2.bin"
+#define NATIVE_TAG_PATH TAG_DIR "/bench.nfpn"
+
+#define BENCH_ACCESS_ID 0x10110100
+
+// Max time to wait for the tag to be found after starting detection
+#define DETECTION_TIMEOUT_MS 5000
+#define PROC_INTERVAL_MS 15
+
+static const char* callNames[] = {
+    "Initialize",
+    "Finalize",
+    "GetNfpState",
+    "StartDetection",
+    "StopDetection",
+    "Mount",
+    "MountReadOnly",
+    "MountRom",
+    "Unmount",
+    "Flush",
+    "CreateApplicationArea",
+    "WriteApplicationArea",
+    "OpenApplicationArea",
+    "ReadApplicationArea",
+    "GetTagInfo",
+    "GetNfpCommonInfo",
+    "GetNfpRegisterInfo",
+    "GetNfpReadOnlyInfo",
+    "GetNfpRomInfo",
+    "GetNfpAdminInfo",
+};
+static_assert(sizeof(callNames) / sizeof(callNames[0]) == NFPII_CALL_MAX, "Missing call names");
+
+static struct {
+    nn::Result (*Initialize)();
+    nn::Result (*Finalize)();
+    NfpState (*GetNfpState)();
+    nn::Result (*StartDetection)();
+    nn::Result (*StopDetection)();
+    nn::Result (*Mount)();
+    nn::Result (*Unmount)();
+    nn::Result (*Flush)();
+    bool (*IsExistApplicationArea)();
+    nn::Result (*CreateApplicationArea)(ApplicationAreaCreateInfo const&);
+    nn::Result (*OpenApplicationArea)(uint32_t);
+    nn::Result (*ReadApplicationArea)(void*, uint32_t);
+    nn::Result (*WriteApplicationArea)(const void*, uint32_t, const TagId&);
+    nn::Result (*GetTagInfo)(TagInfo*);
+    nn::Result (*GetNfpCommonInfo)(CommonInfo*);
+    nn::Result (*GetNfpReadOnlyInfo)(ReadOnlyInfo*);
+    nn::Result (*GetNfpAdminInfo)(AdminInfo*);
+
+    void (*SetEmulationState)(NfpiiEmulationState);
+    void (*SetTagEmulationPath)(const char*);
+    NFCError (*QueueNFCGetTagInfo)(NFCGetTagInfoCallbackFn, void*);
+    bool (*ConvertTag)(const char*, const char*, NfpiiTagFormat);
+    void (*SetVirtualClock)(bool);
+    void (*AdvanceVirtualClock)(uint32_t);
+    uint64_t (*GetStatistic)(NfpiiStatistic);
+    void (*ResetStatistics)();
+    bool (*GetCallProfile)(NfpiiCall, NfpiiCallProfile*);
+} nfp;
+
+template <typename T>
+static void FindExport(T& function, const char* name)
+{
+    function = (T) WUMSHostFindExport(WUMS_FUNCTION_EXPORT, name);
+    if (!function) {
+        fprintf(stderr, "Missing export %s\n", name);
+        exit(1);
+    }
+}
+
+static void FindExports()
+{
+    FindExport(nfp.Initialize, "Initialize__Q2_2nn3nfpFv");
+    FindExport(nfp.Finalize, "Finalize__Q2_2nn3nfpFv");
+    FindExport(nfp.GetNfpState, "GetNfpState__Q2_2nn3nfpFv");
+    FindExport(nfp.StartDetection, "StartDetection__Q2_2nn3nfpFv");
+    FindExport(nfp.StopDetection, "StopDetection__Q2_2nn3nfpFv");
+    FindExport(nfp.Mount, "Mount__Q2_2nn3nfpFv");
+    FindExport(nfp.Unmount, "Unmount__Q2_2nn3nfpFv");
+    FindExport(nfp.Flush, "Flush__Q2_2nn3nfpFv");
+    FindExport(nfp.IsExistApplicationArea, "IsExistApplicationArea__Q2_2nn3nfpFv");
+    FindExport(nfp.CreateApplicationArea, "CreateApplicationArea__Q2_2nn3nfpFRCQ3_2nn3nfp25ApplicationAreaCreateInfo");
+    FindExport(nfp.OpenApplicationArea, "OpenApplicationArea__Q2_2nn3nfpFUi");
+    FindExport(nfp.ReadApplicationArea, "ReadApplicationArea__Q2_2nn3nfpFPvUi");
+    FindExport(nfp.WriteApplicationArea, "WriteApplicationArea__Q2_2nn3nfpFPCvUiRCQ3_2nn3nfp5TagId");
+    FindExport(nfp.GetTagInfo, "GetTagInfo__Q2_2nn3nfpFPQ3_2nn3nfp7TagInfo");
+    FindExport(nfp.GetNfpCommonInfo, "GetNfpCommonInfo__Q2_2nn3nfpFPQ3_2nn3nfp10CommonInfo");
+    FindExport(nfp.GetNfpReadOnlyInfo, "GetNfpReadOnlyInfo__Q2_2nn3nfpFPQ3_2nn3nfp12ReadOnlyInfo");
+    FindExport(nfp.GetNfpAdminInfo, "GetNfpAdminInfo__Q2_2nn3nfpFPQ3_2nn3nfp9AdminInfo");
+
+    FindExport(nfp.SetEmulationState, "NfpiiSetEmulationState");
+    FindExport(nfp.SetTagEmulationPath, "NfpiiSetTagEmulationPath");
+    FindExport(nfp.QueueNFCGetTagInfo, "NfpiiQueueNFCGetTagInfo");
+    FindExport(nfp.ConvertTag, "NfpiiConvertTag");
+    FindExport(nfp.SetVirtualClock, "NfpiiSetVirtualClock");
+    FindExport(nfp.AdvanceVirtualClock, "NfpiiAdvanceVirtualClock");
+    FindExport(nfp.GetStatistic, "NfpiiGetStatistic");
+    FindExport(nfp.ResetStatistics, "NfpiiResetStatistics");
+    FindExport(nfp.GetCallProfile, "NfpiiGetCallProfile");
+}
+
+// Creates an empty amiibo dump, which is "encrypted" with the null cipher of the host's /dev/ccr_nfc
+static bool CreateRawTag(std::string const& path)
+{
+    NTAGRawDataT2T raw;
+    memset(&raw, 0, sizeof(raw));
+
+    static const uint8_t uid[9] = { 0x04, 0x62, 0x6e, 0xa2, 0x2b, 0x4c, 0x80, 0x6d, 0x8f };
+    memcpy(raw.uid, uid, sizeof(uid));
+    raw.internal = 0x48;
+    raw.lockBytes[0] = 0x0f;
+    raw.lockBytes[1] = 0xe0;
+    raw.capabilityContainer[0] = 0xf1;
+    raw.capabilityContainer[1] = 0x10;
+    raw.capabilityContainer[2] = 0xff;
+    raw.capabilityContainer[3] = 0xee;
+
+    raw.section0.magic = 0xa5;
+
+    raw.section1.characterID[0] = 0x00;
+    raw.section1.characterID[1] = 0x00;
+    raw.section1.characterID[2] = 0x00;
+    raw.section1.numberingID = 0x0002;
+    raw.section1.seriesID = 0x01;
+    raw.section1.formatVersion = 2;
+
+    raw.dynamicLock[0] = 0x01;
+    raw.dynamicLock[1] = 0x00;
+    raw.dynamicLock[2] = 0x0f;
+    raw.cfg0[3] = 0x04;
+    raw.cfg1[0] = 0x5f;
+
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) {
+        return false;
+    }
+
+    bool ok = fwrite(&raw, sizeof(raw), 1, f) == 1;
+    fclose(f);
+    return ok;
+}
+
+static bool Check(nn::Result res, const char* call)
+{
+    if (res.IsFailure()) {
+        fprintf(stderr, "%s failed: %x\n", call, ((NNResult) res).value);
+        return false;
+    }
+
+    return true;
+}
+
+// Simulated time each session keeps the tag mounted
+static uint32_t sessionSeconds = 0;
+static uint64_t simulatedMs = 0;
+
+// Moves the module's clock and the alarms forward by one proc interval
+static void Step()
+{
+    nfp.AdvanceVirtualClock(PROC_INTERVAL_MS);
+    HostAdvanceTime(OSMillisecondsToTicks(PROC_INTERVAL_MS));
+    simulatedMs += PROC_INTERVAL_MS;
+}
+
+static bool WaitForTag()
+{
+    for (uint32_t ms = 0; ms < DETECTION_TIMEOUT_MS; ms += PROC_INTERVAL_MS) {
+        if (nfp.GetNfpState() == NfpState::Found) {
+            return true;
+        }
+
+        // Give the loader thread some real time as well
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        Step();
+    }
+
+    fprintf(stderr, "Tag wasn't detected\n");
+    return false;
+}
+
+// One game session: detect the tag, read it and write the application area
+static bool RunSession(uint32_t iteration)
+{
+    if (!Check(nfp.Initialize(), "Initialize")) {
+        return false;
+    }
+
+    bool selectWhileSearching = iteration & 1;
+    if (selectWhileSearching) {
+        nfp.SetEmulationState(NFPII_EMULATION_OFF);
+    }
+
+    if (!Check(nfp.StartDetection(), "StartDetection")) {
+        return false;
+    }
+
+    if (selectWhileSearching) {
+        nfp.SetEmulationState(NFPII_EMULATION_ON);
+    }
+
+    if (!WaitForTag()) {
+        return false;
+    }
+
+    if (!Check(nfp.Mount(), "Mount")) {
+        return false;
+    }
+
+    TagInfo tagInfo;
+    CommonInfo commonInfo;
+    ReadOnlyInfo readOnlyInfo;
+    AdminInfo adminInfo;
+    if (!Check(nfp.GetTagInfo(&tagInfo), "GetTagInfo")
+       || !Check(nfp.GetNfpCommonInfo(&commonInfo), "GetNfpCommonInfo")
+       || !Check(nfp.GetNfpReadOnlyInfo(&readOnlyInfo), "GetNfpReadOnlyInfo")
+       || !Check(nfp.GetNfpAdminInfo(&adminInfo), "GetNfpAdminInfo")) {
+        return false;
+    }
+
+    uint8_t appData[0xd8];
+    if (!nfp.IsExistApplicationArea()) {
+        memset(appData, 0, sizeof(appData));
+
+        ApplicationAreaCreateInfo createInfo;
+        memset(&createInfo, 0, sizeof(createInfo));
+        createInfo.accessID = BENCH_ACCESS_ID;
+        createInfo.data = appData;
+        createInfo.size = sizeof(appData);
+        if (!Check(nfp.CreateApplicationArea(createInfo), "CreateApplicationArea")) {
+            return false;
+        }
+    }
+
+    if (!Check(nfp.OpenApplicationArea(BENCH_ACCESS_ID), "OpenApplicationArea")
+       || !Check(nfp.ReadApplicationArea(appData, sizeof(appData)), "ReadApplicationArea")) {
+        return false;
+    }
+
+    for (uint64_t ms = 0; ms < sessionSeconds * 1000ull; ms += PROC_INTERVAL_MS) {
+        Step();
+    }
+
+    memcpy(appData, &iteration, sizeof(iteration));
+    if (!Check(nfp.WriteApplicationArea(appData, sizeof(appData), tagInfo.id), "WriteApplicationArea")
+       || !Check(nfp.Flush(), "Flush")) {
+        return false;
+    }
+
+    return Check(nfp.Unmount(), "Unmount")
+        && Check(nfp.StopDetection(), "StopDetection")
+        && Check(nfp.Finalize(), "Finalize");
+}
+
+static void PrintResults(uint32_t iterations)
+{
+    printf("%-24s %10s %12s %12s\n", "call", "calls", "avg (us)", "max (us)");
+    for (uint32_t i = 0; i < NFPII_CALL_MAX; i++) {
+        NfpiiCallProfile profile;
+        if (!nfp.GetCallProfile((NfpiiCall) i, &profile) || profile.calls == 0) {
+            continue;
+        }
+
+        printf("%-24s %10llu %12.1f %12llu\n", callNames[i], (unsigned long long) profile.calls,
+            (double) profile.totalTimeUs / profile.calls, (unsigned long long) profile.maxTimeUs);
+    }
+
+    printf("\n%u sessions, %llu tag writes, %llu journal appends, %llu crypt calls, %llu fs ipc calls\n", iterations,
+        (unsigned long long) nfp.GetStatistic(NFPII_STAT_TAG_WRITES),
+        (unsigned long long) nfp.GetStatistic(NFPII_STAT_JOURNAL_APPENDS),
+        (unsigned long long) nfp.GetStatistic(NFPII_STAT_CRYPT_CALLS),
+        (unsigned long long) nfp.GetStatistic(NFPII_STAT_FS_IPC_CALLS));
+    printf("%.1f s simulated, longest proc run %llu us, %llu loader loads\n", simulatedMs / 1000.0,
+        (unsigned long long) nfp.GetStatistic(NFPII_STAT_PROC_MAX_TIME_US),
+        (unsigned long long) nfp.GetStatistic(NFPII_STAT_TAG_LOADER_LOADS));
+}
+
+static void TagInfoCallback(VPADChan chan, NFCError error, NFCTagInfo* tagInfo, void* userContext)
+{
+    *(NFCError*) userContext = error;
+}
+
+// Returns the average time the module spent on a request until its callback ran
+static double PollTagInfo(uint32_t requests, const char* switchPath, const char* tagPath)
+{
+    uint64_t totalUs = 0;
+    for (uint32_t i = 0; i < requests; i++) {
+        // Selecting a different tag drops the resident tag info
+        if (switchPath) {
+            nfp.SetTagEmulationPath((i & 1) ? switchPath : tagPath);
+        }
+
+        NFCError result = 1;
+        auto start = std::chrono::steady_clock::now();
+        nfp.QueueNFCGetTagInfo(TagInfoCallback, &result);
+        HostRunAlarms();
+        auto end = std::chrono::steady_clock::now();
+        totalUs += std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+        // Answers are paced at the proc interval, so the request might only be answered by a later proc
+        for (uint32_t ms = 0; result == 1 && ms < DETECTION_TIMEOUT_MS; ms += PROC_INTERVAL_MS) {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+
+            start = std::chrono::steady_clock::now();
+            Step();
+            end = std::chrono::steady_clock::now();
+            totalUs += std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        }
+
+        if (result != 0) {
+            fprintf(stderr, "NFCGetTagInfo failed: %x\n", result);
+            return -1.0;
+        }
+    }
+
+    nfp.SetTagEmulationPath(tagPath);
+    return (double) totalUs / requests;
+}
+
+static bool RunTagInfoPolling(uint32_t requests, const char* tagPath)
+{
+    if (!Check(nfp.Initialize(), "Initialize")) {
+        return false;
+    }
+
+    printf("\n%-24s %12s %16s\n", "NFCGetTagInfo", "avg (us)", "fs ipc calls");
+
+    struct {
+        const char* name;
+        const char* switchPath;
+    } modes[] = {
+        { "resident", nullptr },
+        { "switching tags", SECOND_TAG_PATH },
+    };
+    for (auto const& mode : modes) {
+        nfp.ResetStatistics();
+
+        double us = PollTagInfo(requests, mode.switchPath, tagPath);
+        if (us < 0.0) {
+            return false;
+        }
+
+        printf("%-24s %12.1f %16.2f\n", mode.name, us,
+            (double) nfp.GetStatistic(NFPII_STAT_FS_IPC_CALLS) / requests);
+    }
+
+    return Check(nfp.Finalize(), "Finalize");
+}
+
+static void Usage(const char* name)
+{
+    fprintf(stderr, "Usage: %s [-n sessions] [-s seconds per session] [-f raw|native] [-r fs root] [-v]\n", name);
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t iterations = 100;
+    bool native = false;
+    std::string root;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iterations = strtoul(argv[++i], nullptr, 0);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            sessionSeconds = strtoul(argv[++i], nullptr, 0);
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            native = strcmp(argv[++i], "native") == 0;
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            root = argv[++i];
+        } else if (strcmp(argv[i], "-v") == 0) {
+            HostSetLogEnabled(TRUE);
+        } else {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (root.empty()) {
+        root = (std::filesystem::temp_directory_path() / "re_nfpii_bench").string();
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(root + TAG_DIR, ec);
+    std::filesystem::create_directories(root + TAG_DATA_DIR, ec);
+    if (ec) {
+        fprintf(stderr, "Failed to create %s: %s\n", root.c_str(), ec.message().c_str());
+        return 1;
+    }
+
+    HostSetFSRoot(root.c_str());
+
+    if (!CreateRawTag(root + RAW_TAG_PATH) || !CreateRawTag(root + SECOND_TAG_PATH)) {
+        fprintf(stderr, "Failed to create the tag\n");
+        return 1;
+    }
+
+    WUMSHostInitialize(nullptr);
+    WUMSHostApplicationStarts();
+    FindExports();
+    nfp.SetVirtualClock(true);
+
+    const char* tagPath = RAW_TAG_PATH;
+    if (native) {
+        if (!nfp.ConvertTag(RAW_TAG_PATH, NATIVE_TAG_PATH, NFPII_TAG_FORMAT_NATIVE)) {
+            fprintf(stderr, "Failed to convert the tag\n");
+            return 1;
+        }
+
+        tagPath = NATIVE_TAG_PATH;
+    }
+
+    nfp.SetTagEmulationPath(tagPath);
+    nfp.SetEmulationState(NFPII_EMULATION_ON);
+    nfp.ResetStatistics();
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        if (!RunSession(i)) {
+            fprintf(stderr, "Session %u failed\n", i);
+            return 1;
+        }
+    }
+
+    PrintResults(iterations);
+
+    if (!RunTagInfoPolling(iterations, tagPath)) {
+        return 1;
+    }
+
+    WUMSHostApplicationEnds();
+    return 0;
+}
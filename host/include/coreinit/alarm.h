@@ -0,0 +1,43 @@
+#pragma once
+
+#include <wut.h>
+#include <coreinit/thread.h>
+#include <coreinit/time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct OSAlarm OSAlarm;
+
+typedef void (*OSAlarmCallback)(OSAlarm* alarm, OSContext* context);
+
+/*  Alarms don't fire on their own on the host. They are kept in a list and
+    fired by HostRunAlarms/HostAdvanceTime on the calling thread, so tests
+    and benchmarks fully control when the module's timers run. */
+struct OSAlarm {
+    const char* name;
+    OSAlarmCallback callback;
+    OSTime nextFire;
+    OSTime period;
+    void* userData;
+    BOOL armed;
+};
+
+void OSCreateAlarm(OSAlarm* alarm);
+
+void OSCreateAlarmEx(OSAlarm* alarm, const char* name);
+
+BOOL OSCancelAlarm(OSAlarm* alarm);
+
+BOOL OSSetAlarm(OSAlarm* alarm, OSTime time, OSAlarmCallback callback);
+
+BOOL OSSetPeriodicAlarm(OSAlarm* alarm, OSTime start, OSTime interval, OSAlarmCallback callback);
+
+void OSSetAlarmUserData(OSAlarm* alarm, void* data);
+
+void* OSGetAlarmUserData(OSAlarm* alarm);
+
+#ifdef __cplusplus
+}
+#endif
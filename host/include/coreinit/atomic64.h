@@ -0,0 +1,21 @@
+#pragma once
+
+#include <wut.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint64_t OSGetAtomic64(volatile uint64_t* ptr);
+
+// Returns the previous value
+uint64_t OSSetAtomic64(volatile uint64_t* ptr, uint64_t value);
+
+BOOL OSCompareAndSwapAtomic64(volatile uint64_t* ptr, uint64_t compare, uint64_t value);
+
+// Returns the previous value
+uint64_t OSAddAtomic64(volatile uint64_t* ptr, uint64_t value);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <wut.h>
+#include <coreinit/mutex.h>
+
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct OSCondition {
+    const char* name;
+    pthread_cond_t cond;
+} OSCondition;
+
+void OSInitCond(OSCondition* condition);
+
+void OSInitCondEx(OSCondition* condition, const char* name);
+
+// Fully releases mutex while waiting, even if it's locked recursively
+void OSWaitCond(OSCondition* condition, OSMutex* mutex);
+
+// Wakes up all waiting threads
+void OSSignalCond(OSCondition* condition);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <wut.h>
+#include <coreinit/thread.h>
+
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum OSEventMode {
+    OS_EVENT_MODE_MANUAL = 0,
+    OS_EVENT_MODE_AUTO   = 1,
+} OSEventMode;
+
+typedef struct OSEvent {
+    const char* name;
+    BOOL value;
+    OSEventMode mode;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} OSEvent;
+
+void OSInitEvent(OSEvent* event, BOOL value, OSEventMode mode);
+
+void OSInitEventEx(OSEvent* event, BOOL value, OSEventMode mode, char* name);
+
+void OSSignalEvent(OSEvent* event);
+
+void OSSignalEventAll(OSEvent* event);
+
+void OSWaitEvent(OSEvent* event);
+
+void OSResetEvent(OSEvent* event);
+
+// timeout is in nanoseconds, like on the console
+BOOL OSWaitEventWithTimeout(OSEvent* event, OSTime timeout);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <wut.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*  FSA backed by a directory on the host.
+    Every path is resolved relative to the root set with HostSetFSRoot,
+    so /vol/external01/wiiu/re_nfpii maps to <root>/vol/external01/wiiu/re_nfpii.
+    Mounting doesn't do anything. */
+
+typedef int32_t FSAClientHandle;
+typedef uint32_t FSAFileHandle;
+typedef int32_t FSError;
+typedef uint32_t FSMode;
+typedef int64_t FSTime;
+
+#define FS_ERROR_OK             0
+#define FS_ERROR_ALREADY_EXISTS -0x30004
+#define FS_ERROR_NOT_FOUND      -0x30005
+#define FS_ERROR_NOT_FILE       -0x30006
+#define FS_ERROR_NOT_DIR        -0x30007
+#define FS_ERROR_MEDIA_ERROR    -0x30011
+#define FS_ERROR_INVALID_PARAM  -0x30027
+#define FS_ERROR_MAX            -0x30029
+
+typedef enum FSOpenFileFlags {
+    FS_OPEN_FLAG_NONE = 0,
+} FSOpenFileFlags;
+
+typedef enum FSAMountFlags {
+    FSA_MOUNT_FLAG_LOCAL_MOUNT = 0,
+    FSA_MOUNT_FLAG_BIND_MOUNT  = 1,
+} FSAMountFlags;
+
+typedef enum FSAUnmountFlags {
+    FSA_UNMOUNT_FLAG_NONE       = 0,
+    FSA_UNMOUNT_FLAG_BIND_MOUNT = 0x80000000,
+} FSAUnmountFlags;
+
+typedef enum FSStatFlags {
+    FS_STAT_DIRECTORY = 0x80000000,
+    FS_STAT_FILE      = 0x01000000,
+} FSStatFlags;
+
+typedef struct FSStat {
+    FSStatFlags flags;
+    FSMode mode;
+    uint32_t owner;
+    uint32_t group;
+    uint32_t size;
+    uint32_t allocSize;
+    uint64_t quotaSize;
+    uint32_t entryId;
+    FSTime created;
+    FSTime modified;
+} FSStat;
+
+typedef FSStat FSAStat;
+
+FSError FSAInit(void);
+
+FSAClientHandle FSAAddClient(void* attachParams);
+
+FSError FSADelClient(FSAClientHandle client);
+
+FSError FSAMount(FSAClientHandle client, const char* source, const char* target, FSAMountFlags flags, void* arg_buf, uint32_t arg_len);
+
+FSError FSAUnmount(FSAClientHandle client, const char* mountedTarget, FSAUnmountFlags flags);
+
+FSError FSAOpenFileEx(FSAClientHandle client, const char* path, const char* mode, FSMode createMode, FSOpenFileFlags openFlag, uint32_t preallocSize, FSAFileHandle* outFileHandle);
+
+FSError FSACloseFile(FSAClientHandle client, FSAFileHandle fileHandle);
+
+// Returns the number of bytes transferred
+FSError FSAReadFile(FSAClientHandle client, void* buffer, uint32_t size, uint32_t count, FSAFileHandle handle, uint32_t flags);
+
+FSError FSAWriteFile(FSAClientHandle client, void* buffer, uint32_t size, uint32_t count, FSAFileHandle handle, uint32_t flags);
+
+FSError FSAGetStat(FSAClientHandle client, const char* path, FSAStat* stat);
+
+FSError FSARemove(FSAClientHandle client, const char* path);
+
+FSError FSAMakeDir(FSAClientHandle client, const char* path, FSMode mode);
+
+#ifdef __cplusplus
+}
+#endif
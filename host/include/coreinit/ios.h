@@ -0,0 +1,29 @@
+#pragma once
+
+#include <wut.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int32_t IOSError;
+typedef int32_t IOSHandle;
+
+typedef enum IOSOpenMode {
+    IOS_OPEN_NONE  = 0,
+    IOS_OPEN_READ  = 1,
+    IOS_OPEN_WRITE = 2,
+} IOSOpenMode;
+
+#define IOS_ERROR_NOEXISTS -6
+
+// Only /dev/ccr_nfc is available, see host/source/ios.cpp
+IOSHandle IOS_Open(const char* device, IOSOpenMode mode);
+
+IOSError IOS_Close(IOSHandle handle);
+
+IOSError IOS_Ioctl(IOSHandle handle, uint32_t request, void* inBuf, uint32_t inLen, void* outBuf, uint32_t outLen);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <wut.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void* OSBlockMove(void* dst, const void* src, uint32_t size, BOOL flush);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <wut.h>
+#include <coreinit/thread.h>
+
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct OSMutex OSMutex;
+
+/*  Recursive like the console's mutex. owner and count are kept in the same
+    fields as coreinit, since the module asserts ownership through them.
+    A zeroed mutex is a valid unlocked mutex. */
+struct OSMutex {
+    const char* name;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    OSThread* owner;
+    int32_t count;
+};
+
+void OSInitMutex(OSMutex* mutex);
+
+void OSInitMutexEx(OSMutex* mutex, const char* name);
+
+void OSLockMutex(OSMutex* mutex);
+
+void OSUnlockMutex(OSMutex* mutex);
+
+BOOL OSTryLockMutex(OSMutex* mutex);
+
+#ifdef __cplusplus
+}
+#endif
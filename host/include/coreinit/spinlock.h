@@ -0,0 +1,23 @@
+#pragma once
+
+#include <wut.h>
+#include <coreinit/thread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct OSSpinLock {
+    OSThread* volatile owner;
+    uint32_t recursion;
+} OSSpinLock;
+
+void OSInitSpinLock(OSSpinLock* spinlock);
+
+BOOL OSUninterruptibleSpinLock_Acquire(OSSpinLock* spinlock);
+
+BOOL OSUninterruptibleSpinLock_Release(OSSpinLock* spinlock);
+
+#ifdef __cplusplus
+}
+#endif
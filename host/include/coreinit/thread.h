@@ -0,0 +1,55 @@
+#pragma once
+
+#include <wut.h>
+#include <coreinit/time.h>
+
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct OSContext OSContext;
+typedef struct OSThread OSThread;
+
+typedef int (*OSThreadEntryPointFn)(int argc, const char** argv);
+
+typedef uint8_t OSThreadAttributes;
+
+enum OSThreadAttributeFlags {
+    OS_THREAD_ATTRIB_AFFINITY_CPU0 = 1 << 0,
+    OS_THREAD_ATTRIB_AFFINITY_CPU1 = 1 << 1,
+    OS_THREAD_ATTRIB_AFFINITY_CPU2 = 1 << 2,
+    OS_THREAD_ATTRIB_AFFINITY_ANY  = 7,
+    OS_THREAD_ATTRIB_DETACHED      = 1 << 3,
+};
+
+// Backed by a pthread, which is started by OSResumeThread
+struct OSThread {
+    pthread_t handle;
+    OSThreadEntryPointFn entry;
+    int32_t argc;
+    char* argv;
+    int result;
+    const char* name;
+    BOOL running;
+};
+
+BOOL OSCreateThread(OSThread* thread, OSThreadEntryPointFn entry, int32_t argc, char* argv, void* stack, uint32_t stackSize, int32_t priority, OSThreadAttributes attributes);
+
+int32_t OSResumeThread(OSThread* thread);
+
+BOOL OSJoinThread(OSThread* thread, int* threadResult);
+
+void OSSetThreadName(OSThread* thread, const char* name);
+
+// Threads not created by OSCreateThread get their own OSThread on first use
+OSThread* OSGetCurrentThread(void);
+
+void OSSleepTicks(OSTime ticks);
+
+void OSYieldThread(void);
+
+#ifdef __cplusplus
+}
+#endif
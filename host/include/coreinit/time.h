@@ -0,0 +1,51 @@
+#pragma once
+
+#include <wut.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int64_t OSTime;
+typedef int32_t OSTick;
+
+typedef struct OSCalendarTime {
+    int32_t tm_sec;
+    int32_t tm_min;
+    int32_t tm_hour;
+    int32_t tm_mday;
+    int32_t tm_mon;
+    int32_t tm_year;
+    int32_t tm_wday;
+    int32_t tm_yday;
+    int32_t tm_msec;
+    int32_t tm_usec;
+} OSCalendarTime;
+
+// Same timer speed as the console, so tick based code behaves the same
+#define OSTimerClockSpeed 62156250ull
+
+#define OSSecondsToTicks(val)      ((uint64_t) (val) * (uint64_t) OSTimerClockSpeed)
+#define OSMillisecondsToTicks(val) (((uint64_t) (val) * (uint64_t) OSTimerClockSpeed) / 1000ull)
+#define OSMicrosecondsToTicks(val) (((uint64_t) (val) * (uint64_t) OSTimerClockSpeed) / 1000000ull)
+#define OSNanosecondsToTicks(val)  (((uint64_t) (val) * ((uint64_t) OSTimerClockSpeed / 31250ull)) / 32000ull)
+
+#define OSTicksToSeconds(val)      ((uint64_t) (val) / (uint64_t) OSTimerClockSpeed)
+#define OSTicksToMilliseconds(val) (((uint64_t) (val) * 1000ull) / (uint64_t) OSTimerClockSpeed)
+#define OSTicksToMicroseconds(val) (((uint64_t) (val) * 1000000ull) / (uint64_t) OSTimerClockSpeed)
+#define OSTicksToNanoseconds(val)  (((uint64_t) (val) * 32000ull) / ((uint64_t) OSTimerClockSpeed / 31250ull))
+
+// Ticks since 2000-01-01, advanced by HostAdvanceTime
+OSTime OSGetTime(void);
+
+OSTime OSGetSystemTime(void);
+
+OSTick OSGetTick(void);
+
+OSTick OSGetSystemTick(void);
+
+void OSTicksToCalendarTime(OSTime time, OSCalendarTime* calendarTime);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <wut.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Can be changed with HostSetTitleID
+uint64_t OSGetTitleID(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <wut.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int32_t UCHandle;
+
+typedef enum UCDataType {
+    UC_DATATYPE_UNDEFINED    = 0x00,
+    UC_DATATYPE_UNSIGNED_INT = 0x03,
+} UCDataType;
+
+typedef enum UCError {
+    UC_ERROR_OK        = 0,
+    UC_ERROR_NOT_FOUND = -12,
+} UCError;
+
+typedef struct UCSysConfig {
+    char name[64];
+    uint32_t access;
+    UCDataType dataType;
+    int32_t error;
+    uint32_t dataSize;
+    void* data;
+} UCSysConfig;
+
+UCHandle UCOpen(void);
+
+void UCClose(UCHandle handle);
+
+UCError UCReadSysConfig(UCHandle handle, uint32_t count, UCSysConfig* settings);
+
+#ifdef __cplusplus
+}
+#endif
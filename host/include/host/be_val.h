@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+
+/*  The tag structures are stored big-endian, like on the console.
+    On the host these fields are wrapped in be_val, which converts to and
+    from the native byte order on every access, so the module code can keep
+    using them like plain integers.
+    C code only sees the plain types, it doesn't access these fields. */
+
+#ifdef __cplusplus
+
+#include <type_traits>
+
+template <typename T>
+class __attribute__((packed)) be_val {
+    static_assert(std::is_integral_v<T>, "be_val only supports integers");
+
+public:
+    be_val() = default;
+
+    be_val(T value)
+    {
+        *this = value;
+    }
+
+    operator T() const
+    {
+        return Swap(raw);
+    }
+
+    be_val& operator=(T value)
+    {
+        raw = Swap(value);
+        return *this;
+    }
+
+    be_val& operator+=(T value) { return *this = *this + value; }
+    be_val& operator-=(T value) { return *this = *this - value; }
+    be_val& operator&=(T value) { return *this = *this & value; }
+    be_val& operator|=(T value) { return *this = *this | value; }
+    be_val& operator^=(T value) { return *this = *this ^ value; }
+
+    be_val& operator++() { return *this += 1; }
+    be_val& operator--() { return *this -= 1; }
+
+private:
+    static T Swap(T value)
+    {
+        if constexpr (sizeof(T) == 1 || __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__) {
+            return value;
+        } else if constexpr (sizeof(T) == 2) {
+            return (T) __builtin_bswap16((uint16_t) value);
+        } else if constexpr (sizeof(T) == 4) {
+            return (T) __builtin_bswap32((uint32_t) value);
+        } else {
+            return (T) __builtin_bswap64((uint64_t) value);
+        }
+    }
+
+    T raw;
+};
+
+#define HOST_BE(type) be_val<type>
+
+#else
+
+#define HOST_BE(type) type
+
+#endif
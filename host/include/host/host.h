@@ -0,0 +1,32 @@
+#pragma once
+
+#include <wut.h>
+#include <coreinit/time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*  Controls for the host stub layer, which aren't part of the console APIs. */
+
+// Directory used as the root of every FSA path
+void HostSetFSRoot(const char* path);
+
+const char* HostGetFSRoot(void);
+
+// Moves OSGetTime and OSGetSystemTime forward and fires all alarms which became due
+void HostAdvanceTime(OSTime ticks);
+
+// Fires all alarms which are due, returns the number of fired alarms
+uint32_t HostRunAlarms(void);
+
+void HostSetTitleID(uint64_t titleId);
+
+void HostSetLogEnabled(BOOL enabled);
+
+// Copies the input buffer of the last /dev/ccr_nfc ioctl, returns its size
+uint32_t HostGetLastCcrNfcRequest(void* outData, uint32_t size);
+
+#ifdef __cplusplus
+}
+#endif
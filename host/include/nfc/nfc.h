@@ -0,0 +1,43 @@
+#pragma once
+
+#include <wut.h>
+#include <vpad/input.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int32_t NFCError;
+
+typedef enum NFCProtocolEnum {
+    NFC_PROTOCOL_UNKNOWN = 0,
+    NFC_PROTOCOL_T1T     = 1,
+    NFC_PROTOCOL_T2T     = 2,
+    NFC_PROTOCOL_T3T     = 3,
+    NFC_PROTOCOL_ISO_DEP = 4,
+    NFC_PROTOCOL_15693   = 6,
+} NFCProtocolEnum;
+typedef uint8_t NFCProtocol;
+
+typedef enum NFCTechnologyEnum {
+    NFC_TECHNOLOGY_A        = 0,
+    NFC_TECHNOLOGY_B        = 1,
+    NFC_TECHNOLOGY_F        = 2,
+    NFC_TECHNOLOGY_ISO15693 = 6,
+} NFCTechnologyEnum;
+typedef uint8_t NFCTechnology;
+
+typedef struct WUT_PACKED NFCTagInfo {
+    uint8_t uidSize;
+    uint8_t uid[10];
+    NFCTechnology technology;
+    NFCProtocol protocol;
+    uint8_t reserved[0x20];
+} NFCTagInfo;
+WUT_CHECK_SIZE(NFCTagInfo, 0x2d);
+
+typedef void (*NFCGetTagInfoCallbackFn)(VPADChan chan, NFCError error, NFCTagInfo* tagInfo, void* userContext);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <wut.h>
+#include <host/be_val.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct WUT_PACKED FFLiMiiDataCore {
+    uint8_t unk_0x00[0x18];
+    uint8_t unk_0x18_b1 : 1;
+    uint8_t unk_0x18_b2 : 7;
+    uint8_t unk_0x19[0x2f];
+} FFLiMiiDataCore;
+WUT_CHECK_SIZE(FFLiMiiDataCore, 0x48);
+
+typedef struct WUT_PACKED FFLiMiiDataOfficial {
+    FFLiMiiDataCore core;
+    uint8_t creatorName[0x14];
+} FFLiMiiDataOfficial;
+WUT_CHECK_SIZE(FFLiMiiDataOfficial, 0x5c);
+
+typedef struct WUT_PACKED FFLStoreData {
+    FFLiMiiDataOfficial data;
+    uint16_t unk_0x5c;
+    HOST_BE(uint16_t) checksum;
+} FFLStoreData;
+WUT_CHECK_SIZE(FFLStoreData, 0x60);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <wut.h>
+#include <coreinit/event.h>
+#include <nn/result.h>
+#include <nn/ffl/miidata.h>
+#include <sysapp/args.h>
+
+#ifdef __cplusplus
+
+namespace nn::nfp {
+
+// Result descriptions used by nn_nfp
+enum {
+    RESULT_OUT_OF_RANGE                = 0x3700 >> 7,
+    RESULT_INVALID_PARAM               = 0x3780 >> 7,
+    RESULT_INVALID_ALIGNMENT           = 0x3800 >> 7,
+    RESULT_INVALID_STATE               = 0x6400 >> 7,
+    RESULT_INVALID_TAG                 = 0xc800 >> 7,
+    RESULT_INVALID_TAG_INFO            = 0xca80 >> 7,
+    RESULT_NO_BACKUPENTRY              = 0xe580 >> 7,
+    RESULT_NO_REGISTER_INFO            = 0x10900 >> 7,
+    RESULT_APP_AREA_MISSING            = 0x10400 >> 7,
+    RESULT_APP_AREA_TAGID_MISMATCH     = 0x11d00 >> 7,
+    RESULT_APP_AREA_ALREADY_EXISTS     = 0x10e00 >> 7,
+    RESULT_APP_AREA_ACCESS_ID_MISMATCH = 0x11300 >> 7,
+    RESULT_NO_BACKUP_SAVEDATA          = 0x38880 >> 7,
+    RESULT_SYSTEM_ERROR                = 0x3e880 >> 7,
+    RESULT_FATAL                       = 0x5db00 >> 7,
+};
+
+enum class NfpState : uint32_t {
+    Uninitialized = 0,
+    Initialized   = 1,
+    Searching     = 2,
+    Found         = 3,
+    Removed       = 4,
+    Mounted       = 5,
+    Unknown6      = 6,
+    MountedROM    = 7,
+};
+
+enum class TagType : uint8_t {
+    Unknown  = 0,
+    Type1Tag = 1,
+    Type2Tag = 2,
+    Type3Tag = 3,
+    Iso15693 = 4,
+};
+
+enum class AdminFlags : uint8_t {
+    IsRegistered       = 1 << 0,
+    HasApplicationData = 1 << 1,
+};
+
+struct TagId {
+    uint8_t size;
+    uint8_t uid[10];
+};
+
+struct TagInfo {
+    TagId id;
+    uint8_t reserved0[0x15];
+    uint8_t technology;
+    TagType tag_type;
+    uint8_t reserved1[0x32];
+};
+
+struct Date {
+    uint16_t year;
+    uint8_t month;
+    uint8_t day;
+};
+
+struct CommonInfo {
+    Date lastWriteDate;
+    uint16_t writes;
+    uint8_t characterID[3];
+    uint8_t seriesID;
+    uint16_t numberingID;
+    uint8_t figureType;
+    uint8_t figureVersion;
+    uint16_t applicationAreaSize;
+    uint8_t reserved[0x30];
+};
+
+struct RegisterInfo {
+    FFLStoreData mii;
+    uint16_t name[11];
+    uint8_t fontRegion;
+    uint8_t country;
+    Date registerDate;
+    uint8_t reserved[0x2c];
+};
+
+struct ReadOnlyInfo {
+    uint8_t characterID[3];
+    uint8_t seriesID;
+    uint16_t numberingID;
+    uint8_t figureType;
+    uint8_t reserved[0x2f];
+};
+
+using RomInfo = ReadOnlyInfo;
+
+struct AdminInfo {
+    uint64_t titleID;
+    uint32_t accessID;
+    uint16_t applicationAreaWrites;
+    AdminFlags flags;
+    uint8_t formatVersion;
+    uint8_t platform;
+    uint8_t reserved[0x2f];
+};
+
+struct ApplicationAreaCreateInfo {
+    uint32_t accessID;
+    void* data;
+    uint32_t size;
+    uint8_t reserved[0x30];
+};
+
+struct RegisterInfoSet {
+    FFLStoreData mii;
+    uint16_t name[11];
+    uint8_t fontRegion;
+    uint8_t reserved[0x2d];
+};
+
+enum class AmiiboSettingsMode : uint8_t {
+    Register      = 0,
+    DeleteData    = 1,
+    RestoreData   = 2,
+};
+
+struct AmiiboSettingsArgsIn {
+    AmiiboSettingsMode mode;
+    TagInfo tag_info;
+    bool is_registered;
+    uint8_t padding[3];
+    RegisterInfo register_info;
+    CommonInfo common_info;
+    uint8_t reserved[0x20];
+};
+
+struct AmiiboSettingsArgs {
+    SYSStandardArgs standardArgs;
+    AmiiboSettingsArgsIn argsIn;
+};
+
+struct AmiiboSettingsResult {
+    int32_t result;
+    TagInfo tag_info;
+    bool is_registered;
+    RegisterInfo register_info;
+    CommonInfo common_info;
+    uint8_t reserved[0x24];
+};
+
+} // namespace nn::nfp
+
+#endif
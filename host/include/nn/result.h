@@ -0,0 +1,53 @@
+#pragma once
+
+#include <wut.h>
+
+typedef struct NNResult {
+    int32_t value;
+} NNResult;
+
+#ifdef __cplusplus
+
+namespace nn {
+
+// Same bit layout as on the console
+class Result {
+public:
+    enum Level {
+        LEVEL_SUCCESS = 0,
+        LEVEL_FATAL   = -1,
+        LEVEL_USAGE   = -2,
+        LEVEL_STATUS  = -3,
+    };
+
+    enum Module {
+        RESULT_MODULE_COMMON = 0,
+        RESULT_MODULE_NN_NFP = 27,
+    };
+
+    Result() : mValue(0) {}
+
+    Result(NNResult result) : mValue(result.value) {}
+
+    Result(Level level, Module module, unsigned description)
+        : mValue(((level & 0x7) << 29) | ((module & 0x1ff) << 20) | ((description & 0x1fff) << 7))
+    {
+    }
+
+    bool IsSuccess() const { return mValue >= 0; }
+
+    bool IsFailure() const { return mValue < 0; }
+
+    unsigned GetModule() const { return (mValue >> 20) & 0x1ff; }
+
+    unsigned GetDescription() const { return mValue & 0xfff80; }
+
+    operator NNResult() const { return NNResult{ mValue }; }
+
+private:
+    int32_t mValue;
+};
+
+} // namespace nn
+
+#endif
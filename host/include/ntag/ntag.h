@@ -0,0 +1,113 @@
+#pragma once
+
+#include <wut.h>
+#include <host/be_val.h>
+#include <nfc/nfc.h>
+#include <nn/ffl/miidata.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*  These are stored in the console's byte order on tags and in tag files,
+    so every multi-byte field is big-endian on the host as well.
+    crc and unknown are only copied around, so they keep the raw bytes. */
+
+typedef struct WUT_PACKED NTAGInfoT2T {
+    uint8_t magic;
+    uint8_t writes_hi;
+    HOST_BE(uint16_t) writes;
+    uint8_t figureVersion;
+    uint8_t flags;
+    uint8_t country;
+    uint8_t fontRegion;
+    HOST_BE(uint16_t) crcCounter;
+    HOST_BE(uint16_t) setupDate;
+    HOST_BE(uint16_t) lastWriteDate;
+    uint32_t crc;
+    uint16_t name[10];
+    HOST_BE(uint32_t) accessID;
+    uint8_t characterID[3];
+    uint8_t figureType;
+    HOST_BE(uint16_t) numberingID;
+    uint8_t seriesID;
+    uint32_t unknown;
+    FFLStoreData mii;
+    HOST_BE(uint64_t) titleID;
+    HOST_BE(uint16_t) applicationAreaWrites;
+    uint8_t reserved[0x2e];
+} NTAGInfoT2T;
+
+typedef struct WUT_PACKED NTAGAppDataT2T {
+    HOST_BE(uint16_t) size;
+    uint8_t data[0xd8];
+} NTAGAppDataT2T;
+WUT_CHECK_SIZE(NTAGAppDataT2T, 0xda);
+
+typedef struct WUT_PACKED NTAGRawDataT2T {
+    uint8_t uid[9];
+    uint8_t internal;
+    uint8_t lockBytes[2];
+    uint8_t capabilityContainer[4];
+
+    struct WUT_PACKED {
+        uint8_t magic;
+        HOST_BE(uint16_t) writes;
+        uint8_t figureVersion;
+        uint8_t flags;
+        uint8_t country;
+        HOST_BE(uint16_t) crcCounter;
+        HOST_BE(uint16_t) setupDate;
+        HOST_BE(uint16_t) lastWriteDate;
+        uint32_t crc;
+        uint16_t name[10];
+    } section0;
+
+    struct WUT_PACKED {
+        uint8_t tagHmac[0x20];
+        uint8_t characterID[3];
+        uint8_t figureType;
+        HOST_BE(uint16_t) numberingID;
+        uint8_t seriesID;
+        uint8_t formatVersion;
+        uint32_t unknown;
+        uint8_t keygenSalt[0x20];
+        uint8_t dataHmac[0x20];
+    } section1;
+
+    struct WUT_PACKED {
+        FFLStoreData mii;
+        HOST_BE(uint64_t) titleID;
+        HOST_BE(uint16_t) applicationAreaWrites;
+        HOST_BE(uint32_t) accessID;
+        uint8_t reserved[0x22];
+    } section2;
+
+    uint8_t applicationData[0xd8];
+    uint8_t dynamicLock[3];
+    uint8_t reserved0;
+    uint8_t cfg0[4];
+    uint8_t cfg1[4];
+    uint8_t pwd[4];
+    uint8_t pack[2];
+    uint8_t reserved1[2];
+} NTAGRawDataT2T;
+WUT_CHECK_SIZE(NTAGRawDataT2T, 0x21c);
+
+typedef struct WUT_PACKED NTAGDataT2T {
+    NFCTagInfo tagInfo;
+    uint8_t formatVersion;
+    NTAGInfoT2T info;
+    NTAGAppDataT2T appData;
+
+    struct WUT_PACKED {
+        HOST_BE(uint16_t) size;
+        NTAGRawDataT2T data;
+    } raw;
+
+    uint8_t reserved[0x20];
+} NTAGDataT2T;
+
+#ifdef __cplusplus
+}
+#endif
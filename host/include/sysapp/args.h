@@ -0,0 +1,39 @@
+#pragma once
+
+#include <wut.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum SYSArgType {
+    SYS_ARG_TYPE_UINT32 = 1,
+    SYS_ARG_TYPE_DATA   = 2,
+    SYS_ARG_TYPE_STRING = 3,
+} SYSArgType;
+
+typedef struct SYSArgDataBlock {
+    SYSArgType type;
+    union {
+        struct {
+            const char* name;
+            uint32_t size;
+            const void* ptr;
+        } data;
+        struct {
+            const char* name;
+            uint32_t value;
+        } u32;
+    };
+} SYSArgDataBlock;
+
+typedef struct SYSStandardArgs {
+    const void* anchor;
+    uint32_t anchorSize;
+    const void* selfData;
+    uint32_t selfDataSize;
+} SYSStandardArgs;
+
+#ifdef __cplusplus
+}
+#endif
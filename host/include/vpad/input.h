@@ -0,0 +1,16 @@
+#pragma once
+
+#include <wut.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum VPADChan {
+    VPAD_CHAN_0 = 0,
+    VPAD_CHAN_1 = 1,
+} VPADChan;
+
+#ifdef __cplusplus
+}
+#endif
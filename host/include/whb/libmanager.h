@@ -0,0 +1,15 @@
+#pragma once
+
+#include <wut.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+BOOL WHBInitializeSocketLibrary(void);
+
+BOOL WHBDeinitializeSocketLibrary(void);
+
+#ifdef __cplusplus
+}
+#endif
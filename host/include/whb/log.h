@@ -0,0 +1,16 @@
+#pragma once
+
+#include <wut.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Output is discarded unless enabled with HostSetLogEnabled
+BOOL WHBLogPrintf(const char* fmt, ...);
+
+BOOL WHBLogWritef(const char* fmt, ...);
+
+#ifdef __cplusplus
+}
+#endif
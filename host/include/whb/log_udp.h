@@ -0,0 +1,13 @@
+#pragma once
+
+#include <wut.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+BOOL WHBLogUdpInit(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,54 @@
+#pragma once
+
+/*  Host replacement for the WUMS headers.
+    Exports are collected in a table, so they can be looked up by name like
+    the loader does on the console. The module hooks become regular functions
+    which the host application has to call itself. */
+
+#include <wut.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum WUMSExportType {
+    WUMS_FUNCTION_EXPORT,
+    WUMS_DATA_EXPORT,
+} WUMSExportType;
+
+typedef struct wums_app_init_args_t wums_app_init_args_t;
+
+void WUMSHostInitialize(wums_app_init_args_t* args);
+void WUMSHostApplicationStarts(void);
+void WUMSHostApplicationEnds(void);
+
+void WUMSHostRegisterExport(WUMSExportType type, const char* name, const void* address);
+
+// Returns the address of the export with the given name, or NULL
+const void* WUMSHostFindExport(WUMSExportType type, const char* name);
+
+#ifdef __cplusplus
+}
+
+struct WUMSHostExport {
+    WUMSHostExport(WUMSExportType type, const char* name, const void* address)
+    {
+        WUMSHostRegisterExport(type, name, address);
+    }
+};
+
+#define WUMS_EXPORT(type, name, function) \
+    static WUMSHostExport wums_host_export_##name(type, #name, (const void*) (function))
+
+#define WUMS_EXPORT_FUNCTION(function) WUMS_EXPORT(WUMS_FUNCTION_EXPORT, function, function)
+#endif
+
+#define WUMS_MODULE_EXPORT_NAME(name)  static_assert(true, "")
+#define WUMS_MODULE_DESCRIPTION(desc)  static_assert(true, "")
+#define WUMS_MODULE_AUTHOR(author)     static_assert(true, "")
+#define WUMS_MODULE_VERSION(version)   static_assert(true, "")
+#define WUMS_MODULE_LICENSE(license)   static_assert(true, "")
+
+#define WUMS_INITIALIZE(args)     void WUMSHostInitialize(wums_app_init_args_t* args)
+#define WUMS_APPLICATION_STARTS() void WUMSHostApplicationStarts(void)
+#define WUMS_APPLICATION_ENDS()   void WUMSHostApplicationEnds(void)
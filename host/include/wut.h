@@ -0,0 +1,28 @@
+#pragma once
+
+// Host replacement for wut.h, only provides what the module uses
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <assert.h>
+
+typedef int32_t BOOL;
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+#define WUT_PACKED __attribute__((__packed__))
+
+#ifdef __cplusplus
+#define WUT_CHECK_SIZE(type, size) static_assert(sizeof(type) == size, #type " must be " #size " bytes")
+#else
+#define WUT_CHECK_SIZE(type, size) _Static_assert(sizeof(type) == size, #type " must be " #size " bytes")
+#endif
+
+#define WUT_CHECK_OFFSET(type, offset, field)
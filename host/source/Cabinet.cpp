@@ -0,0 +1,40 @@
+#include "re_nfpii/Cabinet.hpp"
+#include "re_nfpii/re_nfpii.hpp"
+
+#include <cstring>
+
+// There is no amiibo settings applet on the host
+
+namespace re::nfpii::Cabinet {
+
+Result GetArgs(AmiiboSettingsArgs* args)
+{
+    return NFP_SYSTEM_ERROR;
+}
+
+Result GetResult(AmiiboSettingsResult* result, SYSArgDataBlock const& block)
+{
+    return NFP_SYSTEM_ERROR;
+}
+
+Result InitializeArgsIn(AmiiboSettingsArgsIn* args)
+{
+    if (!args) {
+        return NFP_INVALID_PARAM;
+    }
+
+    memset(args, 0, sizeof(*args));
+    return NFP_SUCCESS;
+}
+
+Result ReturnToCallerWithResult(AmiiboSettingsResult const& result)
+{
+    return NFP_SYSTEM_ERROR;
+}
+
+Result SwitchToCabinet(AmiiboSettingsArgsIn const& args, const char* standardArg, uint32_t standardArgSize)
+{
+    return NFP_SYSTEM_ERROR;
+}
+
+} // namespace re::nfpii::Cabinet
@@ -0,0 +1,21 @@
+#include <coreinit/atomic64.h>
+
+uint64_t OSGetAtomic64(volatile uint64_t* ptr)
+{
+    return __atomic_load_n(ptr, __ATOMIC_SEQ_CST);
+}
+
+uint64_t OSSetAtomic64(volatile uint64_t* ptr, uint64_t value)
+{
+    return __atomic_exchange_n(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+BOOL OSCompareAndSwapAtomic64(volatile uint64_t* ptr, uint64_t compare, uint64_t value)
+{
+    return __atomic_compare_exchange_n(ptr, &compare, value, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+uint64_t OSAddAtomic64(volatile uint64_t* ptr, uint64_t value)
+{
+    return __atomic_fetch_add(ptr, value, __ATOMIC_SEQ_CST);
+}
@@ -0,0 +1,188 @@
+#include <coreinit/filesystem_fsa.h>
+#include <host/host.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+static std::string fsRoot = ".";
+
+static std::mutex fileMutex;
+static std::vector<FILE*> files;
+
+void HostSetFSRoot(const char* path)
+{
+    fsRoot = path;
+}
+
+const char* HostGetFSRoot(void)
+{
+    return fsRoot.c_str();
+}
+
+static std::string ResolvePath(const char* path)
+{
+    if (path[0] == '/') {
+        return fsRoot + path;
+    }
+
+    return fsRoot + "/" + path;
+}
+
+static FSError ErrnoToFSError(int error)
+{
+    switch (error) {
+    case ENOENT:
+        return FS_ERROR_NOT_FOUND;
+    case EEXIST:
+        return FS_ERROR_ALREADY_EXISTS;
+    case EISDIR:
+        return FS_ERROR_NOT_FILE;
+    case ENOTDIR:
+        return FS_ERROR_NOT_DIR;
+    case EINVAL:
+        return FS_ERROR_INVALID_PARAM;
+    default:
+        return FS_ERROR_MEDIA_ERROR;
+    }
+}
+
+static FILE* GetFile(FSAFileHandle handle)
+{
+    std::lock_guard lock(fileMutex);
+
+    if (handle == 0 || handle > files.size()) {
+        return nullptr;
+    }
+
+    return files[handle - 1];
+}
+
+FSError FSAInit(void)
+{
+    return FS_ERROR_OK;
+}
+
+FSAClientHandle FSAAddClient(void* attachParams)
+{
+    return 1;
+}
+
+FSError FSADelClient(FSAClientHandle client)
+{
+    return FS_ERROR_OK;
+}
+
+FSError FSAMount(FSAClientHandle client, const char* source, const char* target, FSAMountFlags flags, void* arg_buf, uint32_t arg_len)
+{
+    return FS_ERROR_OK;
+}
+
+FSError FSAUnmount(FSAClientHandle client, const char* mountedTarget, FSAUnmountFlags flags)
+{
+    return FS_ERROR_OK;
+}
+
+FSError FSAOpenFileEx(FSAClientHandle client, const char* path, const char* mode, FSMode createMode, FSOpenFileFlags openFlag, uint32_t preallocSize, FSAFileHandle* outFileHandle)
+{
+    FILE* file = fopen(ResolvePath(path).c_str(), mode);
+    if (!file) {
+        return ErrnoToFSError(errno);
+    }
+
+    std::lock_guard lock(fileMutex);
+
+    // Reuse a free slot
+    for (size_t i = 0; i < files.size(); i++) {
+        if (!files[i]) {
+            files[i] = file;
+            *outFileHandle = i + 1;
+            return FS_ERROR_OK;
+        }
+    }
+
+    files.push_back(file);
+    *outFileHandle = files.size();
+    return FS_ERROR_OK;
+}
+
+FSError FSACloseFile(FSAClientHandle client, FSAFileHandle fileHandle)
+{
+    std::lock_guard lock(fileMutex);
+
+    if (fileHandle == 0 || fileHandle > files.size() || !files[fileHandle - 1]) {
+        return FS_ERROR_INVALID_PARAM;
+    }
+
+    fclose(files[fileHandle - 1]);
+    files[fileHandle - 1] = nullptr;
+    return FS_ERROR_OK;
+}
+
+FSError FSAReadFile(FSAClientHandle client, void* buffer, uint32_t size, uint32_t count, FSAFileHandle handle, uint32_t flags)
+{
+    FILE* file = GetFile(handle);
+    if (!file) {
+        return FS_ERROR_INVALID_PARAM;
+    }
+
+    size_t read = fread(buffer, size, count, file);
+    if (read == 0 && ferror(file)) {
+        return FS_ERROR_MEDIA_ERROR;
+    }
+
+    return (FSError) read;
+}
+
+FSError FSAWriteFile(FSAClientHandle client, void* buffer, uint32_t size, uint32_t count, FSAFileHandle handle, uint32_t flags)
+{
+    FILE* file = GetFile(handle);
+    if (!file) {
+        return FS_ERROR_INVALID_PARAM;
+    }
+
+    size_t written = fwrite(buffer, size, count, file);
+    if (written == 0 && ferror(file)) {
+        return FS_ERROR_MEDIA_ERROR;
+    }
+
+    return (FSError) written;
+}
+
+FSError FSAGetStat(FSAClientHandle client, const char* path, FSAStat* outStat)
+{
+    struct stat st;
+    if (stat(ResolvePath(path).c_str(), &st) != 0) {
+        return ErrnoToFSError(errno);
+    }
+
+    *outStat = {};
+    outStat->flags = S_ISDIR(st.st_mode) ? FS_STAT_DIRECTORY : FS_STAT_FILE;
+    outStat->mode = st.st_mode & 0777;
+    outStat->size = (uint32_t) st.st_size;
+    outStat->allocSize = (uint32_t) st.st_blocks * 512;
+    outStat->created = (FSTime) st.st_ctim.tv_sec * 1000000 + st.st_ctim.tv_nsec / 1000;
+    outStat->modified = (FSTime) st.st_mtim.tv_sec * 1000000 + st.st_mtim.tv_nsec / 1000;
+    return FS_ERROR_OK;
+}
+
+FSError FSARemove(FSAClientHandle client, const char* path)
+{
+    if (remove(ResolvePath(path).c_str()) != 0) {
+        return ErrnoToFSError(errno);
+    }
+
+    return FS_ERROR_OK;
+}
+
+FSError FSAMakeDir(FSAClientHandle client, const char* path, FSMode mode)
+{
+    if (mkdir(ResolvePath(path).c_str(), 0777) != 0) {
+        return ErrnoToFSError(errno);
+    }
+
+    return FS_ERROR_OK;
+}
@@ -0,0 +1,66 @@
+#include <coreinit/ios.h>
+#include <host/host.h>
+
+#include <algorithm>
+#include <cstring>
+
+/*  The only device is /dev/ccr_nfc, with a null cipher.
+    Encrypting and decrypting returns the data unchanged, so raw dumps created
+    on the host are stored unencrypted. The software crypto backend still
+    does the real amiibo crypto if keys are loaded.
+    The last request is kept, so the layout it was sent in can be checked. */
+
+#define CCR_NFC_HANDLE 1
+
+#define CCR_NFC_IOCTL_ENCRYPT 1
+#define CCR_NFC_IOCTL_DECRYPT 2
+
+#define IOS_ERROR_INVALID -4
+
+// Size of NFCCryptData
+#define CCR_NFC_REQUEST_SIZE 0x248
+
+static uint8_t lastRequest[CCR_NFC_REQUEST_SIZE];
+static uint32_t lastRequestSize = 0;
+
+IOSHandle IOS_Open(const char* device, IOSOpenMode mode)
+{
+    if (strcmp(device, "/dev/ccr_nfc") != 0) {
+        return IOS_ERROR_NOEXISTS;
+    }
+
+    return CCR_NFC_HANDLE;
+}
+
+IOSError IOS_Close(IOSHandle handle)
+{
+    return handle == CCR_NFC_HANDLE ? 0 : IOS_ERROR_INVALID;
+}
+
+IOSError IOS_Ioctl(IOSHandle handle, uint32_t request, void* inBuf, uint32_t inLen, void* outBuf, uint32_t outLen)
+{
+    if (handle != CCR_NFC_HANDLE) {
+        return IOS_ERROR_INVALID;
+    }
+
+    if (request != CCR_NFC_IOCTL_ENCRYPT && request != CCR_NFC_IOCTL_DECRYPT) {
+        return IOS_ERROR_INVALID;
+    }
+
+    if (inLen != outLen) {
+        return IOS_ERROR_INVALID;
+    }
+
+    lastRequestSize = std::min(inLen, (uint32_t) sizeof(lastRequest));
+    memcpy(lastRequest, inBuf, lastRequestSize);
+
+    memmove(outBuf, inBuf, outLen);
+    return 0;
+}
+
+uint32_t HostGetLastCcrNfcRequest(void* outData, uint32_t size)
+{
+    uint32_t copySize = std::min(size, lastRequestSize);
+    memcpy(outData, lastRequest, copySize);
+    return copySize;
+}
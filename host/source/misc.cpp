@@ -0,0 +1,110 @@
+#include <coreinit/memory.h>
+#include <coreinit/title.h>
+#include <coreinit/userconfig.h>
+#include <whb/log.h>
+#include <whb/log_cafe.h>
+#include <whb/log_module.h>
+#include <whb/log_udp.h>
+#include <host/host.h>
+
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+// Smash Bros USA, any Wii U title id works
+#define HOST_DEFAULT_TITLE_ID 0x0005000010144f00ull
+
+// USA
+#define HOST_COUNTRY_REGION 49
+
+static std::atomic<uint64_t> titleId{HOST_DEFAULT_TITLE_ID};
+static std::atomic<bool> logEnabled{false};
+
+void* OSBlockMove(void* dst, const void* src, uint32_t size, BOOL flush)
+{
+    return memmove(dst, src, size);
+}
+
+void HostSetTitleID(uint64_t id)
+{
+    titleId = id;
+}
+
+uint64_t OSGetTitleID(void)
+{
+    return titleId;
+}
+
+UCHandle UCOpen(void)
+{
+    return 0;
+}
+
+void UCClose(UCHandle handle)
+{
+}
+
+UCError UCReadSysConfig(UCHandle handle, uint32_t count, UCSysConfig* settings)
+{
+    UCError result = UC_ERROR_OK;
+    for (uint32_t i = 0; i < count; i++) {
+        UCSysConfig* config = &settings[i];
+        if (strcmp(config->name, "cafe.cntry_reg") == 0 && config->dataSize == sizeof(uint32_t)) {
+            *(uint32_t*) config->data = HOST_COUNTRY_REGION;
+            config->error = UC_ERROR_OK;
+        } else {
+            config->error = UC_ERROR_NOT_FOUND;
+            result = UC_ERROR_NOT_FOUND;
+        }
+    }
+
+    return result;
+}
+
+void HostSetLogEnabled(BOOL enabled)
+{
+    logEnabled = enabled;
+}
+
+BOOL WHBLogPrintf(const char* fmt, ...)
+{
+    if (!logEnabled) {
+        return FALSE;
+    }
+
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    fputc('\n', stderr);
+    return TRUE;
+}
+
+BOOL WHBLogWritef(const char* fmt, ...)
+{
+    if (!logEnabled) {
+        return FALSE;
+    }
+
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    return TRUE;
+}
+
+BOOL WHBLogModuleInit(void)
+{
+    return TRUE;
+}
+
+BOOL WHBLogCafeInit(void)
+{
+    return TRUE;
+}
+
+BOOL WHBLogUdpInit(void)
+{
+    return TRUE;
+}
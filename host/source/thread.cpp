@@ -0,0 +1,299 @@
+#include <coreinit/thread.h>
+#include <coreinit/mutex.h>
+#include <coreinit/condition.h>
+#include <coreinit/event.h>
+#include <coreinit/spinlock.h>
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <sched.h>
+
+static thread_local OSThread* currentThread = nullptr;
+
+static void* ThreadTrampoline(void* arg)
+{
+    OSThread* thread = (OSThread*) arg;
+    currentThread = thread;
+
+    thread->result = thread->entry(thread->argc, (const char**) thread->argv);
+    return nullptr;
+}
+
+BOOL OSCreateThread(OSThread* thread, OSThreadEntryPointFn entry, int32_t argc, char* argv, void* stack, uint32_t stackSize, int32_t priority, OSThreadAttributes attributes)
+{
+    memset(thread, 0, sizeof(*thread));
+    thread->entry = entry;
+    thread->argc = argc;
+    thread->argv = argv;
+    return TRUE;
+}
+
+int32_t OSResumeThread(OSThread* thread)
+{
+    if (thread->running) {
+        return 0;
+    }
+
+    if (pthread_create(&thread->handle, nullptr, ThreadTrampoline, thread) != 0) {
+        return 0;
+    }
+
+    thread->running = TRUE;
+    return 1;
+}
+
+BOOL OSJoinThread(OSThread* thread, int* threadResult)
+{
+    if (!thread->running) {
+        return FALSE;
+    }
+
+    pthread_join(thread->handle, nullptr);
+    thread->running = FALSE;
+
+    if (threadResult) {
+        *threadResult = thread->result;
+    }
+
+    return TRUE;
+}
+
+void OSSetThreadName(OSThread* thread, const char* name)
+{
+    thread->name = name;
+}
+
+OSThread* OSGetCurrentThread(void)
+{
+    if (!currentThread) {
+        static thread_local OSThread self;
+        self.handle = pthread_self();
+        self.running = TRUE;
+        currentThread = &self;
+    }
+
+    return currentThread;
+}
+
+void OSSleepTicks(OSTime ticks)
+{
+    uint64_t ns = OSTicksToNanoseconds(ticks);
+    timespec ts = { (time_t) (ns / 1000000000ull), (long) (ns % 1000000000ull) };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+void OSYieldThread(void)
+{
+    sched_yield();
+}
+
+void OSInitMutex(OSMutex* mutex)
+{
+    OSInitMutexEx(mutex, nullptr);
+}
+
+void OSInitMutexEx(OSMutex* mutex, const char* name)
+{
+    mutex->name = name;
+    pthread_mutex_init(&mutex->lock, nullptr);
+    pthread_cond_init(&mutex->cond, nullptr);
+    mutex->owner = nullptr;
+    mutex->count = 0;
+}
+
+void OSLockMutex(OSMutex* mutex)
+{
+    OSThread* self = OSGetCurrentThread();
+
+    pthread_mutex_lock(&mutex->lock);
+    while (mutex->owner && mutex->owner != self) {
+        pthread_cond_wait(&mutex->cond, &mutex->lock);
+    }
+
+    mutex->owner = self;
+    mutex->count++;
+    pthread_mutex_unlock(&mutex->lock);
+}
+
+void OSUnlockMutex(OSMutex* mutex)
+{
+    pthread_mutex_lock(&mutex->lock);
+    if (mutex->owner == OSGetCurrentThread() && --mutex->count == 0) {
+        mutex->owner = nullptr;
+        pthread_cond_broadcast(&mutex->cond);
+    }
+    pthread_mutex_unlock(&mutex->lock);
+}
+
+BOOL OSTryLockMutex(OSMutex* mutex)
+{
+    OSThread* self = OSGetCurrentThread();
+
+    pthread_mutex_lock(&mutex->lock);
+    if (mutex->owner && mutex->owner != self) {
+        pthread_mutex_unlock(&mutex->lock);
+        return FALSE;
+    }
+
+    mutex->owner = self;
+    mutex->count++;
+    pthread_mutex_unlock(&mutex->lock);
+    return TRUE;
+}
+
+void OSInitCond(OSCondition* condition)
+{
+    OSInitCondEx(condition, nullptr);
+}
+
+void OSInitCondEx(OSCondition* condition, const char* name)
+{
+    condition->name = name;
+    pthread_cond_init(&condition->cond, nullptr);
+}
+
+void OSWaitCond(OSCondition* condition, OSMutex* mutex)
+{
+    OSThread* self = OSGetCurrentThread();
+
+    pthread_mutex_lock(&mutex->lock);
+
+    // Release the mutex completely, and restore the recursion count afterwards
+    int32_t count = mutex->count;
+    mutex->owner = nullptr;
+    mutex->count = 0;
+    pthread_cond_broadcast(&mutex->cond);
+
+    pthread_cond_wait(&condition->cond, &mutex->lock);
+
+    while (mutex->owner) {
+        pthread_cond_wait(&mutex->cond, &mutex->lock);
+    }
+
+    mutex->owner = self;
+    mutex->count = count;
+    pthread_mutex_unlock(&mutex->lock);
+}
+
+void OSSignalCond(OSCondition* condition)
+{
+    pthread_cond_broadcast(&condition->cond);
+}
+
+void OSInitEvent(OSEvent* event, BOOL value, OSEventMode mode)
+{
+    OSInitEventEx(event, value, mode, nullptr);
+}
+
+void OSInitEventEx(OSEvent* event, BOOL value, OSEventMode mode, char* name)
+{
+    event->name = name;
+    event->value = value;
+    event->mode = mode;
+    pthread_mutex_init(&event->lock, nullptr);
+    pthread_cond_init(&event->cond, nullptr);
+}
+
+void OSSignalEvent(OSEvent* event)
+{
+    pthread_mutex_lock(&event->lock);
+    event->value = TRUE;
+    if (event->mode == OS_EVENT_MODE_AUTO) {
+        pthread_cond_signal(&event->cond);
+    } else {
+        pthread_cond_broadcast(&event->cond);
+    }
+    pthread_mutex_unlock(&event->lock);
+}
+
+void OSSignalEventAll(OSEvent* event)
+{
+    pthread_mutex_lock(&event->lock);
+    event->value = TRUE;
+    pthread_cond_broadcast(&event->cond);
+    pthread_mutex_unlock(&event->lock);
+}
+
+void OSWaitEvent(OSEvent* event)
+{
+    pthread_mutex_lock(&event->lock);
+    while (!event->value) {
+        pthread_cond_wait(&event->cond, &event->lock);
+    }
+
+    if (event->mode == OS_EVENT_MODE_AUTO) {
+        event->value = FALSE;
+    }
+    pthread_mutex_unlock(&event->lock);
+}
+
+void OSResetEvent(OSEvent* event)
+{
+    pthread_mutex_lock(&event->lock);
+    event->value = FALSE;
+    pthread_mutex_unlock(&event->lock);
+}
+
+BOOL OSWaitEventWithTimeout(OSEvent* event, OSTime timeout)
+{
+    // This waits in real time, advancing the host time doesn't affect it
+    timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout / 1000000000ll;
+    deadline.tv_nsec += timeout % 1000000000ll;
+    if (deadline.tv_nsec >= 1000000000l) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000l;
+    }
+
+    pthread_mutex_lock(&event->lock);
+    while (!event->value) {
+        if (pthread_cond_timedwait(&event->cond, &event->lock, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+
+    BOOL signaled = event->value;
+    if (signaled && event->mode == OS_EVENT_MODE_AUTO) {
+        event->value = FALSE;
+    }
+    pthread_mutex_unlock(&event->lock);
+
+    return signaled;
+}
+
+void OSInitSpinLock(OSSpinLock* spinlock)
+{
+    spinlock->owner = nullptr;
+    spinlock->recursion = 0;
+}
+
+BOOL OSUninterruptibleSpinLock_Acquire(OSSpinLock* spinlock)
+{
+    OSThread* self = OSGetCurrentThread();
+    if (__atomic_load_n(&spinlock->owner, __ATOMIC_ACQUIRE) == self) {
+        spinlock->recursion++;
+        return TRUE;
+    }
+
+    OSThread* expected = nullptr;
+    while (!__atomic_compare_exchange_n(&spinlock->owner, &expected, self, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        expected = nullptr;
+        sched_yield();
+    }
+
+    return TRUE;
+}
+
+BOOL OSUninterruptibleSpinLock_Release(OSSpinLock* spinlock)
+{
+    if (spinlock->recursion > 0) {
+        spinlock->recursion--;
+        return TRUE;
+    }
+
+    __atomic_store_n(&spinlock->owner, nullptr, __ATOMIC_RELEASE);
+    return TRUE;
+}
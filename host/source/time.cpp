@@ -0,0 +1,192 @@
+#include <coreinit/time.h>
+#include <coreinit/alarm.h>
+#include <host/host.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <mutex>
+#include <vector>
+
+// Seconds between the unix epoch and the console epoch (2000-01-01)
+#define OS_EPOCH_OFFSET 946684800ll
+
+// Stop firing alarms which keep re-arming themselves without any delay
+#define HOST_MAX_ALARMS_PER_RUN 10000
+
+static std::atomic<int64_t> timeOffset{0};
+
+static std::mutex alarmMutex;
+static std::vector<OSAlarm*> armedAlarms;
+
+static OSTime NanosecondsToTicks(int64_t ns)
+{
+    // Split this up to not overflow for large values
+    return (ns / 1000000000ll) * (int64_t) OSTimerClockSpeed
+        + ((ns % 1000000000ll) * (int64_t) OSTimerClockSpeed) / 1000000000ll;
+}
+
+static OSTime GetMonotonicTicks()
+{
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch());
+    return NanosecondsToTicks(ns.count());
+}
+
+// Console time at startup, OSGetTime then counts from there using the monotonic clock
+static OSTime GetStartTime()
+{
+    static const OSTime startTime = []() {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch());
+        return NanosecondsToTicks(ns.count() - OS_EPOCH_OFFSET * 1000000000ll) - GetMonotonicTicks();
+    }();
+
+    return startTime;
+}
+
+OSTime OSGetTime(void)
+{
+    return GetStartTime() + GetMonotonicTicks() + timeOffset.load();
+}
+
+OSTime OSGetSystemTime(void)
+{
+    return GetMonotonicTicks() + timeOffset.load();
+}
+
+OSTick OSGetTick(void)
+{
+    return (OSTick) OSGetTime();
+}
+
+OSTick OSGetSystemTick(void)
+{
+    return (OSTick) OSGetSystemTime();
+}
+
+void OSTicksToCalendarTime(OSTime time, OSCalendarTime* calendarTime)
+{
+    int64_t seconds = time / (int64_t) OSTimerClockSpeed;
+    int64_t remainder = time % (int64_t) OSTimerClockSpeed;
+
+    time_t t = (time_t) (seconds + OS_EPOCH_OFFSET);
+    tm tm;
+    gmtime_r(&t, &tm);
+
+    calendarTime->tm_sec = tm.tm_sec;
+    calendarTime->tm_min = tm.tm_min;
+    calendarTime->tm_hour = tm.tm_hour;
+    calendarTime->tm_mday = tm.tm_mday;
+    calendarTime->tm_mon = tm.tm_mon;
+    calendarTime->tm_year = tm.tm_year + 1900;
+    calendarTime->tm_wday = tm.tm_wday;
+    calendarTime->tm_yday = tm.tm_yday;
+    calendarTime->tm_msec = (int32_t) OSTicksToMilliseconds(remainder);
+    calendarTime->tm_usec = (int32_t) (OSTicksToMicroseconds(remainder) % 1000);
+}
+
+static void RemoveAlarmLocked(OSAlarm* alarm)
+{
+    armedAlarms.erase(std::remove(armedAlarms.begin(), armedAlarms.end(), alarm), armedAlarms.end());
+    alarm->armed = FALSE;
+}
+
+void OSCreateAlarm(OSAlarm* alarm)
+{
+    OSCreateAlarmEx(alarm, nullptr);
+}
+
+void OSCreateAlarmEx(OSAlarm* alarm, const char* name)
+{
+    alarm->name = name;
+    alarm->callback = nullptr;
+    alarm->nextFire = 0;
+    alarm->period = 0;
+    alarm->userData = nullptr;
+    alarm->armed = FALSE;
+}
+
+BOOL OSCancelAlarm(OSAlarm* alarm)
+{
+    std::lock_guard lock(alarmMutex);
+
+    BOOL wasArmed = alarm->armed;
+    RemoveAlarmLocked(alarm);
+    return wasArmed;
+}
+
+static BOOL ArmAlarm(OSAlarm* alarm, OSTime nextFire, OSTime period, OSAlarmCallback callback)
+{
+    std::lock_guard lock(alarmMutex);
+
+    RemoveAlarmLocked(alarm);
+    alarm->callback = callback;
+    alarm->nextFire = nextFire;
+    alarm->period = period;
+    alarm->armed = TRUE;
+    armedAlarms.push_back(alarm);
+    return TRUE;
+}
+
+BOOL OSSetAlarm(OSAlarm* alarm, OSTime time, OSAlarmCallback callback)
+{
+    return ArmAlarm(alarm, OSGetTime() + time, 0, callback);
+}
+
+BOOL OSSetPeriodicAlarm(OSAlarm* alarm, OSTime start, OSTime interval, OSAlarmCallback callback)
+{
+    return ArmAlarm(alarm, start, interval, callback);
+}
+
+void OSSetAlarmUserData(OSAlarm* alarm, void* data)
+{
+    alarm->userData = data;
+}
+
+void* OSGetAlarmUserData(OSAlarm* alarm)
+{
+    return alarm->userData;
+}
+
+uint32_t HostRunAlarms(void)
+{
+    uint32_t fired = 0;
+    while (fired < HOST_MAX_ALARMS_PER_RUN) {
+        OSAlarm* alarm = nullptr;
+        OSAlarmCallback callback;
+        {
+            std::lock_guard lock(alarmMutex);
+
+            // Fire the alarm which is due first
+            OSTime now = OSGetTime();
+            for (OSAlarm* a : armedAlarms) {
+                if (a->nextFire <= now && (!alarm || a->nextFire < alarm->nextFire)) {
+                    alarm = a;
+                }
+            }
+
+            if (!alarm) {
+                break;
+            }
+
+            callback = alarm->callback;
+            if (alarm->period > 0) {
+                alarm->nextFire += alarm->period;
+            } else {
+                RemoveAlarmLocked(alarm);
+            }
+        }
+
+        // The callback might re-arm or cancel the alarm, so it can't run with the lock held
+        callback(alarm, nullptr);
+        fired++;
+    }
+
+    return fired;
+}
+
+void HostAdvanceTime(OSTime ticks)
+{
+    timeOffset += ticks;
+    HostRunAlarms();
+}
@@ -0,0 +1,33 @@
+#include <wums.h>
+
+#include <cstring>
+#include <vector>
+
+struct ExportEntry {
+    WUMSExportType type;
+    const char* name;
+    const void* address;
+};
+
+// Exports are registered from static constructors, so this can't be a plain global
+static std::vector<ExportEntry>& GetExports()
+{
+    static std::vector<ExportEntry> exports;
+    return exports;
+}
+
+void WUMSHostRegisterExport(WUMSExportType type, const char* name, const void* address)
+{
+    GetExports().push_back({ type, name, address });
+}
+
+const void* WUMSHostFindExport(WUMSExportType type, const char* name)
+{
+    for (ExportEntry const& e : GetExports()) {
+        if (e.type == type && strcmp(e.name, name) == 0) {
+            return e.address;
+        }
+    }
+
+    return nullptr;
+}
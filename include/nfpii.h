@@ -28,30 +28,189 @@ typedef enum NfpiiLogVerbosity {
     NFPII_LOG_VERBOSITY_ERROR,
 } NfpiiLogVerbosity;
 
+typedef enum NfpiiCryptBackend {
+    NFPII_CRYPT_BACKEND_CCR_NFC,
+    NFPII_CRYPT_BACKEND_SOFTWARE,
+} NfpiiCryptBackend;
+
+typedef enum NfpiiTagFormat {
+    NFPII_TAG_FORMAT_RAW,
+    NFPII_TAG_FORMAT_NATIVE,
+} NfpiiTagFormat;
+
+typedef enum NfpiiActivationProfile {
+    // The tag is found as soon as detection starts
+    NFPII_ACTIVATION_PROFILE_INSTANT,
+    // The tag is found after a delay like on hardware, for titles which break on instant detection
+    NFPII_ACTIVATION_PROFILE_HARDWARE,
+
+    NFPII_ACTIVATION_PROFILE_MAX,
+} NfpiiActivationProfile;
+
+typedef enum NfpiiStatistic {
+    NFPII_STAT_TAG_CACHE_HITS,
+    NFPII_STAT_TAG_CACHE_MISSES,
+    NFPII_STAT_NFC_TAG_INFO_CACHE_HITS,
+    NFPII_STAT_NFC_TAG_INFO_CACHE_MISSES,
+    NFPII_STAT_CRYPT_CALLS,
+    NFPII_STAT_CRYPT_TIME_US,
+    NFPII_STAT_CRYPT_MAX_TIME_US,
+    NFPII_STAT_CRYPT_SESSION_OPENS,
+    NFPII_STAT_TAG_WRITES_QUEUED,
+    NFPII_STAT_TAG_WRITES_COALESCED,
+    NFPII_STAT_TAG_WRITES,
+    NFPII_STAT_TAG_WRITE_FAILURES,
+    NFPII_STAT_TAG_WRITE_MAX_TIME_US,
+    NFPII_STAT_JOURNAL_APPENDS,
+    NFPII_STAT_JOURNAL_COMPACTIONS,
+    NFPII_STAT_JOURNAL_REPLAYED_RECORDS,
+    NFPII_STAT_FS_READS,
+    NFPII_STAT_FS_WRITES,
+    NFPII_STAT_FS_IPC_CALLS,
+    NFPII_STAT_PROC_WAKEUPS,
+    NFPII_STAT_RESIDENT_TAG_HITS,
+    NFPII_STAT_RESIDENT_TAG_MISSES,
+    NFPII_STAT_PREFETCH_LOADS,
+    NFPII_STAT_PREFETCH_HITS,
+    NFPII_STAT_TAG_LOADER_LOADS,
+    NFPII_STAT_PROC_MAX_TIME_US,
+    NFPII_STAT_FIRST_DETECTION_TIME_US,
+    NFPII_STAT_FIRST_DETECTION_PRELOADED,
+    // Acquisitions of the nfp mutex by the public calls, and how many of them were recursive
+    NFPII_STAT_MANAGER_LOCKS,
+    NFPII_STAT_MANAGER_RECURSIVE_LOCKS,
+    // Proc ticks which couldn't take the mutex and were deferred until it was released
+    NFPII_STAT_PROC_SKIPPED_TICKS,
+    NFPII_STAT_PROC_DEFERRED_RUNS,
+    // Histogram of how long deferred proc work waited before it ran
+    NFPII_STAT_PROC_DEFER_DELAY_UNDER_1MS,
+    NFPII_STAT_PROC_DEFER_DELAY_UNDER_5MS,
+    NFPII_STAT_PROC_DEFER_DELAY_UNDER_15MS,
+    NFPII_STAT_PROC_DEFER_DELAY_OVER_15MS,
+    // nfpState transitions which aren't in the transition table
+    NFPII_STAT_ILLEGAL_STATE_TRANSITIONS,
+    NFPII_STAT_NFC_TAG_INFO_TIMEOUTS,
+
+    NFPII_STAT_MAX,
+} NfpiiStatistic;
+
+typedef enum NfpiiCall {
+    NFPII_CALL_INITIALIZE,
+    NFPII_CALL_FINALIZE,
+    NFPII_CALL_GET_NFP_STATE,
+    NFPII_CALL_START_DETECTION,
+    NFPII_CALL_STOP_DETECTION,
+    NFPII_CALL_MOUNT,
+    NFPII_CALL_MOUNT_READ_ONLY,
+    NFPII_CALL_MOUNT_ROM,
+    NFPII_CALL_UNMOUNT,
+    NFPII_CALL_FLUSH,
+    NFPII_CALL_CREATE_APPLICATION_AREA,
+    NFPII_CALL_WRITE_APPLICATION_AREA,
+    NFPII_CALL_OPEN_APPLICATION_AREA,
+    NFPII_CALL_READ_APPLICATION_AREA,
+    NFPII_CALL_GET_TAG_INFO,
+    NFPII_CALL_GET_NFP_COMMON_INFO,
+    NFPII_CALL_GET_NFP_REGISTER_INFO,
+    NFPII_CALL_GET_NFP_READ_ONLY_INFO,
+    NFPII_CALL_GET_NFP_ROM_INFO,
+    NFPII_CALL_GET_NFP_ADMIN_INFO,
+
+    NFPII_CALL_MAX,
+} NfpiiCall;
+
+// Which structs NfpiiGetAllTagInfo was able to fill
+typedef enum NfpiiTagInfoFlags {
+    NFPII_TAG_INFO_TAG          = 1 << 0,
+    NFPII_TAG_INFO_COMMON       = 1 << 1,
+    NFPII_TAG_INFO_REGISTER     = 1 << 2,
+    NFPII_TAG_INFO_READ_ONLY    = 1 << 3,
+    NFPII_TAG_INFO_ADMIN        = 1 << 4,
+} NfpiiTagInfoFlags;
+
+typedef struct NfpiiCallProfile {
+    uint64_t calls;
+    uint64_t totalTimeUs;
+    uint64_t maxTimeUs;
+} NfpiiCallProfile;
+
+// A change of the nn::nfp state, timeUs is the system time in microseconds
+typedef struct NfpiiStateTransition {
+    uint64_t timeUs;
+    uint32_t fromState;
+    uint32_t toState;
+} NfpiiStateTransition;
+
 typedef void (*NfpiiLogHandler)(NfpiiLogVerbosity verb, const char* message);
 
 uint32_t NfpiiGetVersion(void);
 
 bool NfpiiIsInitialized(void);
 
-void NfpiiSetEmulationState(NfpiiEmulationState state);
+void NfpiiSetEmulationState(enum NfpiiEmulationState state);
 
-NfpiiEmulationState NfpiiGetEmulationState(void);
+enum NfpiiEmulationState NfpiiGetEmulationState(void);
 
-void NfpiiSetUUIDRandomizationState(NfpiiUUIDRandomizationState state);
+void NfpiiSetUUIDRandomizationState(enum NfpiiUUIDRandomizationState state);
 
-NfpiiUUIDRandomizationState NfpiiGetUUIDRandomizationState(void);
+enum NfpiiUUIDRandomizationState NfpiiGetUUIDRandomizationState(void);
 
 void NfpiiSetRemoveAfterSeconds(float seconds);
 
 void NfpiiSetTagEmulationPath(const char* path);
 
+// The returned path stays valid, but is overwritten by the next NfpiiSetTagEmulationPath
 const char* NfpiiGetTagEmulationPath(void);
 
+// Copies the tag emulation path into outPath, returns false if it doesn't fit into size bytes
+bool NfpiiGetTagEmulationPathEx(char* outPath, uint32_t size);
+
 NFCError NfpiiQueueNFCGetTagInfo(NFCGetTagInfoCallbackFn callback, void* arg);
 
+NFCError NfpiiQueueNFCGetTagInfoEx(NFCGetTagInfoCallbackFn callback, void* arg, uint32_t timeout);
+
 void NfpiiSetLogHandler(NfpiiLogHandler handler);
 
+bool NfpiiConvertTag(const char* srcPath, const char* dstPath, NfpiiTagFormat format);
+
+void NfpiiSetCryptBackend(NfpiiCryptBackend backend);
+
+NfpiiCryptBackend NfpiiGetCryptBackend(void);
+
+uint64_t NfpiiGetStatistic(NfpiiStatistic stat);
+
+void NfpiiResetStatistics(void);
+
+bool NfpiiGetCallProfile(NfpiiCall call, NfpiiCallProfile* outProfile);
+
+uint32_t NfpiiSetPrefetchTags(const char* const* paths, uint32_t numPaths);
+
+bool NfpiiIsTagPrefetched(const char* path);
+
+void NfpiiSetVirtualClock(bool enabled);
+
+void NfpiiAdvanceVirtualClock(uint32_t milliseconds);
+
+uint32_t NfpiiGetStateTrace(NfpiiStateTransition* outTransitions, uint32_t maxTransitions);
+
+bool NfpiiSetActivationProfile(uint64_t titleId, NfpiiActivationProfile profile);
+
+NfpiiActivationProfile NfpiiGetActivationProfile(uint64_t titleId);
+
 #ifdef __cplusplus
 }
+
+#include <nn/nfp.h>
+
+// Info of the current tag, the nn::nfp types are only available from C++
+struct NfpiiAllTagInfo {
+    nn::nfp::TagInfo tagInfo;
+    nn::nfp::CommonInfo commonInfo;
+    nn::nfp::RegisterInfo registerInfo;
+    nn::nfp::ReadOnlyInfo readOnlyInfo;
+    nn::nfp::AdminInfo adminInfo;
+};
+
+// Fills all info of the current tag at once, returns NfpiiTagInfoFlags of the filled structs
+extern "C" uint32_t NfpiiGetAllTagInfo(NfpiiAllTagInfo* outInfo);
 #endif
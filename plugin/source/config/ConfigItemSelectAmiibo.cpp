@@ -11,6 +11,7 @@
 #include <algorithm>
 #include <sstream>
 
+#include <nfpii.h>
 #include <coreinit/title.h>
 #include <vpad/input.h>
 #include <padscore/kpad.h>
@@ -60,7 +61,18 @@ std::vector<std::string>& ConfigItemSelectAmiibo_GetFavorites(void)
     return favorites;
 }
 
-void ConfigItemSelectAmiibo_Init(std::string rootPath, bool favoritesPerTitle)
+// Let the module decrypt the favorites in the background, so quick select doesn't have to wait for the SD
+static void updatePrefetchTags()
+{
+    std::vector<const char*> paths;
+    for (const auto& fav : favorites) {
+        paths.push_back(fav.c_str());
+    }
+
+    NfpiiSetPrefetchTags(paths.data(), paths.size());
+}
+
+static void loadFavorites(std::string rootPath, bool favoritesPerTitle)
 {
     favorites.clear();
     favoritesUpdated = false;
@@ -98,6 +110,12 @@ void ConfigItemSelectAmiibo_Init(std::string rootPath, bool favoritesPerTitle)
     delete[] favoritesString;
 }
 
+void ConfigItemSelectAmiibo_Init(std::string rootPath, bool favoritesPerTitle)
+{
+    loadFavorites(rootPath, favoritesPerTitle);
+    updatePrefetchTags();
+}
+
 static void saveFavorites(ConfigItemSelectAmiibo* item)
 {
     if (!favoritesUpdated || favorites.size() == 0) {
@@ -339,6 +357,7 @@ static void enterSelectionMenu(ConfigItemSelectAmiibo* item)
                     }
 
                     favoritesUpdated = true;
+                    updatePrefetchTags();
                     redraw = true;
                 }
             }
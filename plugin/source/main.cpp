@@ -65,6 +65,13 @@ INITIALIZE_PLUGIN()
             NfpiiSetEmulationState((NfpiiEmulationState) emulationState);
         }
 
+        int32_t cryptBackend = (int32_t) NfpiiGetCryptBackend();
+        if ((err = WUPS_GetInt(nullptr, "cryptBackend", &cryptBackend)) == WUPS_STORAGE_ERROR_NOT_FOUND) {
+            WUPS_StoreInt(nullptr, "cryptBackend", cryptBackend);
+        } else if (err == WUPS_STORAGE_ERROR_SUCCESS) {
+            NfpiiSetCryptBackend((NfpiiCryptBackend) cryptBackend);
+        }
+
         if ((err = WUPS_GetInt(nullptr, "removeAfter", (int32_t*) &currentRemoveAfterOption)) == WUPS_STORAGE_ERROR_NOT_FOUND) {
             WUPS_StoreInt(nullptr, "removeAfter", currentRemoveAfterOption);
         } else if (err == WUPS_STORAGE_ERROR_SUCCESS) {
@@ -72,7 +79,9 @@ INITIALIZE_PLUGIN()
         }
 
         char path[PATH_MAX];
-        strncpy(path, NfpiiGetTagEmulationPath(), PATH_MAX - 1);
+        if (!NfpiiGetTagEmulationPathEx(path, sizeof(path))) {
+            path[0] = '\0';
+        }
         if ((err = WUPS_GetString(nullptr, "currentPath", path, PATH_MAX)) == WUPS_STORAGE_ERROR_NOT_FOUND) {
             WUPS_StoreString(nullptr, "currentPath", path);
         } else if (err == WUPS_STORAGE_ERROR_SUCCESS) {
@@ -141,6 +150,12 @@ static void removeAfterChangedCallback(ConfigItemMultipleValues* values, uint32_
     NfpiiSetRemoveAfterSeconds(index / 2.0f);
 }
 
+static void cryptBackendChangedCallback(ConfigItemMultipleValues* values, uint32_t index)
+{
+    WUPS_StoreInt(nullptr, "cryptBackend", (int32_t) index);
+    NfpiiSetCryptBackend((NfpiiCryptBackend) index);
+}
+
 static void uuidRandomizationChangedCallback(ConfigItemMultipleValues* values, uint32_t index)
 {
     NfpiiSetUUIDRandomizationState((NfpiiUUIDRandomizationState) index);
@@ -207,6 +222,13 @@ WUPS_GET_CONFIG()
         free(removeAfterValues[i].valueName);
     }
 
+    ConfigItemMultipleValuesPair cryptBackendValues[2];
+    cryptBackendValues[0].value = NFPII_CRYPT_BACKEND_CCR_NFC;
+    cryptBackendValues[0].valueName = (char*) "/dev/ccr_nfc";
+    cryptBackendValues[1].value = NFPII_CRYPT_BACKEND_SOFTWARE;
+    cryptBackendValues[1].valueName = (char*) "Software (requires keys)";
+    WUPSConfigItemMultipleValues_AddToCategoryHandled(config, cat, "crypt_backend", "Crypto Backend", NfpiiGetCryptBackend(), cryptBackendValues, 2, cryptBackendChangedCallback);
+
 #if 0 //TODO
     values[0].value = RANDOMIZATION_OFF;
     values[0].valueName = (char*) "Off";
@@ -217,8 +239,11 @@ WUPS_GET_CONFIG()
     WUPSConfigItemMultipleValues_AddToCategoryHandled(config, cat, "random_uuid", "Randomize UUID", NfpiiGetUUIDRandomizationState(), values, 3, uuidRandomizationChangedCallback);
 #endif
 
-    std::string currentAmiiboPath = NfpiiGetTagEmulationPath();
-    ConfigItemSelectAmiibo_AddToCategoryHandled(config, cat, "select_amiibo", "Select Amiibo", TAG_EMULATION_PATH.c_str(), currentAmiiboPath.c_str(), amiiboSelectedCallback);
+    char currentAmiiboPath[PATH_MAX];
+    if (!NfpiiGetTagEmulationPathEx(currentAmiiboPath, sizeof(currentAmiiboPath))) {
+        currentAmiiboPath[0] = '\0';
+    }
+    ConfigItemSelectAmiibo_AddToCategoryHandled(config, cat, "select_amiibo", "Select Amiibo", TAG_EMULATION_PATH.c_str(), currentAmiiboPath, amiiboSelectedCallback);
 
     WUPSConfigItemBoolean_AddToCategoryHandled(config, cat, "favorites_per_title", "Per-Title Favorites", favoritesPerTitle, favoritesPerTitleCallback);
 
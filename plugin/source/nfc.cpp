@@ -8,7 +8,8 @@
 
 /*  Some games call NFCGetTagInfo for amiibo detection instead of using nn_nfp for some reason.
     Notably Amiibo Festival and Mario Party 10 are doing this.
-    This function replacement passes the callback to the module, which calls it on the next nfc proc.
+    This function replacement passes the callback to the module, which calls it on the next nfc proc,
+    or once the timeout expired if no tag is present.
 */
 
 DECL_FUNCTION(NFCError, NFCGetTagInfo, uint32_t index, uint32_t timeout, NFCGetTagInfoCallbackFn callback, void* arg)
@@ -23,7 +24,7 @@ DECL_FUNCTION(NFCError, NFCGetTagInfo, uint32_t index, uint32_t timeout, NFCGetT
         return -0x1385;
     }
 
-    return NfpiiQueueNFCGetTagInfo(callback, arg);
+    return NfpiiQueueNFCGetTagInfoEx(callback, arg, timeout);
 }
 
 WUPS_MUST_REPLACE(NFCGetTagInfo, WUPS_LOADER_LIBRARY_NFC, NFCGetTagInfo);
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct Aes128Context {
+    uint8_t roundKeys[176];
+} Aes128Context;
+
+void Aes128Init(Aes128Context* ctx, const uint8_t* key);
+
+void Aes128EncryptBlock(const Aes128Context* ctx, const uint8_t* in, uint8_t* out);
+
+// Encrypts/decrypts size bytes in counter mode, the 128-bit counter is incremented as big endian
+void Aes128Ctr(const Aes128Context* ctx, const uint8_t* iv, const uint8_t* in, uint8_t* out, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,155 @@
+#include "amiibo_crypt.h"
+#include "aes128.h"
+#include "sha256.h"
+
+#include <string.h>
+
+/*  Software implementation of what /dev/ccr_nfc does to encrypt/decrypt amiibo data.
+    Keys are derived per tag from the master keys using a HMAC-SHA256 based DRBG,
+    the data is then encrypted using AES-128-CTR and signed with two HMACs. */
+
+#define HMAC_POS_DATA 0x008
+#define HMAC_POS_TAG 0x1b4
+
+#define SEED_SIZE 0x40
+#define MAX_PREPARED_SEED_SIZE 0x60
+
+typedef struct DerivedKeys {
+    uint8_t aesKey[16];
+    uint8_t aesIV[16];
+    uint8_t hmacKey[16];
+} DerivedKeys;
+
+int AmiiboLoadKeys(AmiiboKeys* keys, const void* data, uint32_t size)
+{
+    if (size < sizeof(AmiiboKeys)) {
+        return -1;
+    }
+
+    memcpy(keys, data, sizeof(AmiiboKeys));
+
+    if (keys->data.magicBytesSize > sizeof(keys->data.magicBytes) ||
+        keys->tag.magicBytesSize > sizeof(keys->tag.magicBytes)) {
+        return -1;
+    }
+
+    return 0;
+}
+
+static void calcSeed(const uint8_t* data, uint8_t* seed)
+{
+    memcpy(seed + 0x00, data + 0x029, 0x02);
+    memset(seed + 0x02, 0x00, 0x0e);
+    memcpy(seed + 0x10, data + 0x1d4, 0x08);
+    memcpy(seed + 0x18, data + 0x1d4, 0x08);
+    memcpy(seed + 0x20, data + 0x1e8, 0x20);
+}
+
+static void deriveKeys(const AmiiboMasterKey* masterKey, const uint8_t* data, DerivedKeys* outKeys)
+{
+    uint8_t seed[SEED_SIZE];
+    calcSeed(data, seed);
+
+    // The counter is prepended to the seed, so leave 2 bytes at the start
+    uint8_t buffer[2 + MAX_PREPARED_SEED_SIZE];
+    uint8_t* ptr = buffer + 2;
+
+    // Type string including the null terminator
+    size_t typeStringSize = strnlen(masterKey->typeString, sizeof(masterKey->typeString));
+    if (typeStringSize < sizeof(masterKey->typeString)) {
+        typeStringSize++;
+    }
+    memcpy(ptr, masterKey->typeString, typeStringSize);
+    ptr += typeStringSize;
+
+    // Leading seed bytes followed by the magic bytes
+    size_t leadingSeedBytes = 16 - masterKey->magicBytesSize;
+    memcpy(ptr, seed, leadingSeedBytes);
+    ptr += leadingSeedBytes;
+    memcpy(ptr, masterKey->magicBytes, masterKey->magicBytesSize);
+    ptr += masterKey->magicBytesSize;
+
+    memcpy(ptr, seed + 0x10, 16);
+    ptr += 16;
+
+    for (int i = 0; i < 32; i++) {
+        ptr[i] = seed[0x20 + i] ^ masterKey->xorPad[i];
+    }
+    ptr += 32;
+
+    size_t bufferSize = ptr - buffer;
+
+    // Generate the output in 32 byte steps
+    uint8_t output[SHA256_HASH_SIZE * 2];
+    for (uint16_t i = 0; i < 2; i++) {
+        buffer[0] = (uint8_t) (i >> 8);
+        buffer[1] = (uint8_t) i;
+        HmacSha256(masterKey->hmacKey, sizeof(masterKey->hmacKey), buffer, bufferSize, output + i * SHA256_HASH_SIZE);
+    }
+
+    memcpy(outKeys, output, sizeof(DerivedKeys));
+}
+
+static void cipher(const DerivedKeys* keys, const uint8_t* in, uint8_t* out)
+{
+    Aes128Context aes;
+    Aes128Init(&aes, keys->aesKey);
+    Aes128Ctr(&aes, keys->aesIV, in + 0x02c, out + 0x02c, 0x188);
+
+    // The HMACs are not copied here
+    memcpy(out + 0x000, in + 0x000, 0x008);
+    memcpy(out + 0x028, in + 0x028, 0x004);
+    memcpy(out + 0x1d4, in + 0x1d4, 0x034);
+}
+
+static void calcTagHmac(const DerivedKeys* tagKeys, const uint8_t* plain, uint8_t* outHmac)
+{
+    HmacSha256(tagKeys->hmacKey, sizeof(tagKeys->hmacKey), plain + 0x1d4, 0x34, outHmac);
+}
+
+static void calcDataHmac(const DerivedKeys* dataKeys, const uint8_t* plain, const uint8_t* tagHmac, uint8_t* outHmac)
+{
+    // The data HMAC covers the tag HMAC as well, so that one needs to be calculated first
+    HmacSha256Context ctx;
+    HmacSha256Init(&ctx, dataKeys->hmacKey, sizeof(dataKeys->hmacKey));
+    HmacSha256Update(&ctx, plain + 0x029, HMAC_POS_TAG - 0x029);
+    HmacSha256Update(&ctx, tagHmac, SHA256_HASH_SIZE);
+    HmacSha256Update(&ctx, plain + 0x1d4, 0x34);
+    HmacSha256Final(&ctx, outHmac);
+}
+
+int AmiiboDecrypt(const AmiiboKeys* keys, const uint8_t* in, uint8_t* out)
+{
+    DerivedKeys dataKeys;
+    DerivedKeys tagKeys;
+    deriveKeys(&keys->data, in, &dataKeys);
+    deriveKeys(&keys->tag, in, &tagKeys);
+
+    cipher(&dataKeys, in, out);
+
+    // Regenerate the HMACs and verify them against the stored ones
+    calcTagHmac(&tagKeys, out, out + HMAC_POS_TAG);
+    calcDataHmac(&dataKeys, out, out + HMAC_POS_TAG, out + HMAC_POS_DATA);
+
+    if (memcmp(out + HMAC_POS_TAG, in + HMAC_POS_TAG, SHA256_HASH_SIZE) != 0 ||
+        memcmp(out + HMAC_POS_DATA, in + HMAC_POS_DATA, SHA256_HASH_SIZE) != 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+int AmiiboEncrypt(const AmiiboKeys* keys, const uint8_t* in, uint8_t* out)
+{
+    DerivedKeys dataKeys;
+    DerivedKeys tagKeys;
+    deriveKeys(&keys->data, in, &dataKeys);
+    deriveKeys(&keys->tag, in, &tagKeys);
+
+    calcTagHmac(&tagKeys, in, out + HMAC_POS_TAG);
+    calcDataHmac(&dataKeys, in, out + HMAC_POS_TAG, out + HMAC_POS_DATA);
+
+    cipher(&dataKeys, in, out);
+
+    return 0;
+}
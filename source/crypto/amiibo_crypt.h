@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Size of the amiibo data covered by the keys and HMACs, in the /dev/ccr_nfc layout
+#define AMIIBO_CRYPT_DATA_SIZE 0x208
+
+typedef struct AmiiboMasterKey {
+    uint8_t hmacKey[16];
+    char typeString[14];
+    uint8_t rfu;
+    uint8_t magicBytesSize;
+    uint8_t magicBytes[16];
+    uint8_t xorPad[32];
+} AmiiboMasterKey;
+
+// Layout of the commonly used key_retail.bin
+typedef struct AmiiboKeys {
+    AmiiboMasterKey data;
+    AmiiboMasterKey tag;
+} AmiiboKeys;
+
+int AmiiboLoadKeys(AmiiboKeys* keys, const void* data, uint32_t size);
+
+/*  Both functions operate on data in the layout /dev/ccr_nfc uses (see ntag_crypt.cpp).
+    Only the first AMIIBO_CRYPT_DATA_SIZE bytes of in are processed and written to out.
+    in and out must not overlap. */
+
+int AmiiboDecrypt(const AmiiboKeys* keys, const uint8_t* in, uint8_t* out);
+
+int AmiiboEncrypt(const AmiiboKeys* keys, const uint8_t* in, uint8_t* out);
+
+#ifdef __cplusplus
+}
+#endif
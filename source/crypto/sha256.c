@@ -0,0 +1,174 @@
+#include "sha256.h"
+
+#include <string.h>
+
+static const uint32_t k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256Transform(Sha256Context* ctx, const uint8_t* block)
+{
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t) block[i * 4] << 24) | ((uint32_t) block[i * 4 + 1] << 16)
+            | ((uint32_t) block[i * 4 + 2] << 8) | ((uint32_t) block[i * 4 + 3]);
+    }
+
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = ctx->state[0], b = ctx->state[1], c = ctx->state[2], d = ctx->state[3];
+    uint32_t e = ctx->state[4], f = ctx->state[5], g = ctx->state[6], h = ctx->state[7];
+
+    for (int i = 0; i < 64; i++) {
+        uint32_t s1 = ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25);
+        uint32_t ch = (e & f) ^ (~e & g);
+        uint32_t t1 = h + s1 + ch + k[i] + w[i];
+        uint32_t s0 = ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22);
+        uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t t2 = s0 + maj;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    ctx->state[0] += a;
+    ctx->state[1] += b;
+    ctx->state[2] += c;
+    ctx->state[3] += d;
+    ctx->state[4] += e;
+    ctx->state[5] += f;
+    ctx->state[6] += g;
+    ctx->state[7] += h;
+}
+
+void Sha256Init(Sha256Context* ctx)
+{
+    ctx->state[0] = 0x6a09e667;
+    ctx->state[1] = 0xbb67ae85;
+    ctx->state[2] = 0x3c6ef372;
+    ctx->state[3] = 0xa54ff53a;
+    ctx->state[4] = 0x510e527f;
+    ctx->state[5] = 0x9b05688c;
+    ctx->state[6] = 0x1f83d9ab;
+    ctx->state[7] = 0x5be0cd19;
+    ctx->length = 0;
+    ctx->bufferSize = 0;
+}
+
+void Sha256Update(Sha256Context* ctx, const void* data, size_t size)
+{
+    const uint8_t* ptr = (const uint8_t*) data;
+    ctx->length += size;
+
+    while (size > 0) {
+        size_t toCopy = SHA256_BLOCK_SIZE - ctx->bufferSize;
+        if (toCopy > size) {
+            toCopy = size;
+        }
+
+        memcpy(ctx->buffer + ctx->bufferSize, ptr, toCopy);
+        ctx->bufferSize += toCopy;
+        ptr += toCopy;
+        size -= toCopy;
+
+        if (ctx->bufferSize == SHA256_BLOCK_SIZE) {
+            sha256Transform(ctx, ctx->buffer);
+            ctx->bufferSize = 0;
+        }
+    }
+}
+
+void Sha256Final(Sha256Context* ctx, uint8_t* outHash)
+{
+    uint64_t bitLength = ctx->length * 8;
+
+    // Pad with 0x80 followed by zeros, leaving 8 bytes for the length
+    uint8_t pad = 0x80;
+    Sha256Update(ctx, &pad, 1);
+    pad = 0x00;
+    while (ctx->bufferSize != SHA256_BLOCK_SIZE - 8) {
+        Sha256Update(ctx, &pad, 1);
+    }
+
+    uint8_t lengthBytes[8];
+    for (int i = 0; i < 8; i++) {
+        lengthBytes[i] = (uint8_t) (bitLength >> (56 - i * 8));
+    }
+    Sha256Update(ctx, lengthBytes, sizeof(lengthBytes));
+
+    for (int i = 0; i < 8; i++) {
+        outHash[i * 4] = (uint8_t) (ctx->state[i] >> 24);
+        outHash[i * 4 + 1] = (uint8_t) (ctx->state[i] >> 16);
+        outHash[i * 4 + 2] = (uint8_t) (ctx->state[i] >> 8);
+        outHash[i * 4 + 3] = (uint8_t) (ctx->state[i]);
+    }
+}
+
+void HmacSha256Init(HmacSha256Context* ctx, const void* key, size_t keySize)
+{
+    uint8_t keyBlock[SHA256_BLOCK_SIZE];
+    memset(keyBlock, 0, sizeof(keyBlock));
+
+    // Keys longer than the block size get hashed first
+    if (keySize > SHA256_BLOCK_SIZE) {
+        Sha256Init(&ctx->inner);
+        Sha256Update(&ctx->inner, key, keySize);
+        Sha256Final(&ctx->inner, keyBlock);
+    } else {
+        memcpy(keyBlock, key, keySize);
+    }
+
+    uint8_t pad[SHA256_BLOCK_SIZE];
+    for (int i = 0; i < SHA256_BLOCK_SIZE; i++) {
+        pad[i] = keyBlock[i] ^ 0x36;
+    }
+    Sha256Init(&ctx->inner);
+    Sha256Update(&ctx->inner, pad, sizeof(pad));
+
+    for (int i = 0; i < SHA256_BLOCK_SIZE; i++) {
+        pad[i] = keyBlock[i] ^ 0x5c;
+    }
+    Sha256Init(&ctx->outer);
+    Sha256Update(&ctx->outer, pad, sizeof(pad));
+}
+
+void HmacSha256Update(HmacSha256Context* ctx, const void* data, size_t size)
+{
+    Sha256Update(&ctx->inner, data, size);
+}
+
+void HmacSha256Final(HmacSha256Context* ctx, uint8_t* outHash)
+{
+    uint8_t innerHash[SHA256_HASH_SIZE];
+    Sha256Final(&ctx->inner, innerHash);
+
+    Sha256Update(&ctx->outer, innerHash, sizeof(innerHash));
+    Sha256Final(&ctx->outer, outHash);
+}
+
+void HmacSha256(const void* key, size_t keySize, const void* data, size_t size, uint8_t* outHash)
+{
+    HmacSha256Context ctx;
+    HmacSha256Init(&ctx, key, keySize);
+    HmacSha256Update(&ctx, data, size);
+    HmacSha256Final(&ctx, outHash);
+}
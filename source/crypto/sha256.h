@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SHA256_BLOCK_SIZE 64
+#define SHA256_HASH_SIZE 32
+
+typedef struct Sha256Context {
+    uint32_t state[8];
+    uint64_t length;
+    uint8_t buffer[SHA256_BLOCK_SIZE];
+    uint32_t bufferSize;
+} Sha256Context;
+
+typedef struct HmacSha256Context {
+    Sha256Context inner;
+    Sha256Context outer;
+} HmacSha256Context;
+
+void Sha256Init(Sha256Context* ctx);
+
+void Sha256Update(Sha256Context* ctx, const void* data, size_t size);
+
+void Sha256Final(Sha256Context* ctx, uint8_t* outHash);
+
+void HmacSha256Init(HmacSha256Context* ctx, const void* key, size_t keySize);
+
+void HmacSha256Update(HmacSha256Context* ctx, const void* data, size_t size);
+
+void HmacSha256Final(HmacSha256Context* ctx, uint8_t* outHash);
+
+void HmacSha256(const void* key, size_t keySize, const void* data, size_t size, uint8_t* outHash);
+
+#ifdef __cplusplus
+}
+#endif
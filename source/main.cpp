@@ -9,6 +9,8 @@
 #include <re_nfpii/re_nfpii.hpp>
 
 #include "utils/LogHandler.hpp"
+#include "utils/stats.h"
+#include "ntag_crypt.h"
 
 #define STR_VALUE(arg) #arg
 #define VERSION_STRING(x, y, z) "v" STR_VALUE(x) "." STR_VALUE(y) "." STR_VALUE(z)
@@ -35,12 +37,25 @@ WUMS_APPLICATION_STARTS()
         WHBLogCafeInit();
         WHBLogUdpInit();
     }
+
+    // Statistics are collected per application
+    StatsReset();
+
+    // Start loading the selected tag, so the first detection doesn't have to wait for the SD
+    re::nfpii::tagManager.Preload();
 }
 
 WUMS_APPLICATION_ENDS()
 {
     // Call finalize in case the application doesn't
+    // This also makes sure all pending tag writes are done
     re::nfpii::tagManager.Finalize();
+
+    // The callbacks of any pending NFCGetTagInfo requests point into the application
+    re::nfpii::tagManager.ClearNFCGetTagInfoRequests();
+
+    // Stop the preload, if the application never used nfp
+    re::nfpii::tagManager.CancelPreload();
 }
 
 uint32_t NfpiiGetVersion(void)
@@ -94,14 +109,114 @@ void NfpiiSetTagEmulationPath(const char* path)
 
 const char* NfpiiGetTagEmulationPath(void)
 {
-    return re::nfpii::tagManager.GetTagEmulationPath().c_str();
+    return re::nfpii::tagManager.GetStableTagEmulationPath();
+}
+
+bool NfpiiGetTagEmulationPathEx(char* outPath, uint32_t size)
+{
+    std::string path = re::nfpii::tagManager.GetTagEmulationPath();
+    if (!outPath || path.size() >= size) {
+        return false;
+    }
+
+    memcpy(outPath, path.c_str(), path.size() + 1);
+    return true;
 }
 
 NFCError NfpiiQueueNFCGetTagInfo(NFCGetTagInfoCallbackFn callback, void* arg)
 {
     LogHandler::Info("Module: Queued NFCGetTagInfo");
 
-    return re::nfpii::tagManager.QueueNFCGetTagInfo(callback, arg);
+    return re::nfpii::tagManager.QueueNFCGetTagInfo(callback, arg, 0);
+}
+
+NFCError NfpiiQueueNFCGetTagInfoEx(NFCGetTagInfoCallbackFn callback, void* arg, uint32_t timeout)
+{
+    LogHandler::Info("Module: Queued NFCGetTagInfo (timeout %u)", timeout);
+
+    return re::nfpii::tagManager.QueueNFCGetTagInfo(callback, arg, timeout);
+}
+
+bool NfpiiConvertTag(const char* srcPath, const char* dstPath, NfpiiTagFormat format)
+{
+    LogHandler::Info("Module: Converting %s to %s (format %d)", srcPath, dstPath, format);
+
+    return re::nfpii::tagManager.ConvertTag(srcPath, dstPath, format).IsSuccess();
+}
+
+void NfpiiSetCryptBackend(NfpiiCryptBackend backend)
+{
+    LogHandler::Info("Module: Updated crypt backend to: %d", backend);
+
+    NTAGSetCryptBackend(backend);
+}
+
+NfpiiCryptBackend NfpiiGetCryptBackend(void)
+{
+    return NTAGGetCryptBackend();
+}
+
+uint64_t NfpiiGetStatistic(NfpiiStatistic stat)
+{
+    return StatsGet(stat);
+}
+
+void NfpiiResetStatistics(void)
+{
+    StatsReset();
+}
+
+bool NfpiiGetCallProfile(NfpiiCall call, NfpiiCallProfile* outProfile)
+{
+    return StatsGetCallProfile(call, outProfile);
+}
+
+uint32_t NfpiiSetPrefetchTags(const char* const* paths, uint32_t numPaths)
+{
+    LogHandler::Info("Module: Updated prefetch list (%u tags)", numPaths);
+
+    return re::nfpii::tagManager.GetTagPrefetcher().SetTags(paths, numPaths);
+}
+
+bool NfpiiIsTagPrefetched(const char* path)
+{
+    return re::nfpii::tagManager.GetTagPrefetcher().IsPrefetched(path);
+}
+
+uint32_t NfpiiGetAllTagInfo(NfpiiAllTagInfo* outInfo)
+{
+    uint32_t flags = 0;
+    re::nfpii::tagManager.GetAllTagInfo(outInfo, &flags);
+    return flags;
+}
+
+void NfpiiSetVirtualClock(bool enabled)
+{
+    LogHandler::Info("Module: Updated virtual clock to: %d", enabled);
+
+    re::nfpii::tagManager.SetVirtualClockEnabled(enabled);
+}
+
+void NfpiiAdvanceVirtualClock(uint32_t milliseconds)
+{
+    re::nfpii::tagManager.AdvanceVirtualClock(OSMillisecondsToTicks(milliseconds));
+}
+
+uint32_t NfpiiGetStateTrace(NfpiiStateTransition* outTransitions, uint32_t maxTransitions)
+{
+    return re::nfpii::tagManager.GetStateTrace(outTransitions, maxTransitions);
+}
+
+bool NfpiiSetActivationProfile(uint64_t titleId, NfpiiActivationProfile profile)
+{
+    LogHandler::Info("Module: Updated activation profile of %016llx to: %d", titleId, profile);
+
+    return re::nfpii::tagManager.GetActivationProfiles().Set(titleId, profile);
+}
+
+NfpiiActivationProfile NfpiiGetActivationProfile(uint64_t titleId)
+{
+    return re::nfpii::tagManager.GetActivationProfiles().Get(titleId);
 }
 
 WUMS_EXPORT_FUNCTION(NfpiiIsInitialized);
@@ -112,4 +227,20 @@ WUMS_EXPORT_FUNCTION(NfpiiGetUUIDRandomizationState);
 WUMS_EXPORT_FUNCTION(NfpiiSetRemoveAfterSeconds);
 WUMS_EXPORT_FUNCTION(NfpiiSetTagEmulationPath);
 WUMS_EXPORT_FUNCTION(NfpiiGetTagEmulationPath);
+WUMS_EXPORT_FUNCTION(NfpiiGetTagEmulationPathEx);
 WUMS_EXPORT_FUNCTION(NfpiiQueueNFCGetTagInfo);
+WUMS_EXPORT_FUNCTION(NfpiiQueueNFCGetTagInfoEx);
+WUMS_EXPORT_FUNCTION(NfpiiConvertTag);
+WUMS_EXPORT_FUNCTION(NfpiiSetCryptBackend);
+WUMS_EXPORT_FUNCTION(NfpiiGetCryptBackend);
+WUMS_EXPORT_FUNCTION(NfpiiGetStatistic);
+WUMS_EXPORT_FUNCTION(NfpiiResetStatistics);
+WUMS_EXPORT_FUNCTION(NfpiiGetCallProfile);
+WUMS_EXPORT_FUNCTION(NfpiiSetPrefetchTags);
+WUMS_EXPORT_FUNCTION(NfpiiIsTagPrefetched);
+WUMS_EXPORT_FUNCTION(NfpiiGetAllTagInfo);
+WUMS_EXPORT_FUNCTION(NfpiiSetVirtualClock);
+WUMS_EXPORT_FUNCTION(NfpiiAdvanceVirtualClock);
+WUMS_EXPORT_FUNCTION(NfpiiGetStateTrace);
+WUMS_EXPORT_FUNCTION(NfpiiSetActivationProfile);
+WUMS_EXPORT_FUNCTION(NfpiiGetActivationProfile);
@@ -0,0 +1,399 @@
+#include "ntag_crypt.h"
+#include "crypto/amiibo_crypt.h"
+#include "debug/logger.h"
+#include "utils/stats.h"
+
+#include <string.h>
+#include <coreinit/ios.h>
+#include <coreinit/time.h>
+
+/*  This file handles converting nfc data and encrypting/decrypting the 
+    data using /dev/ccr_nfc. It's mainly based on what ntag.rpl does after
+    reading or before writing tags.
+    This should probably be replaced with a custom format without encryption
+    at some point.
+    Alternatively the encryption can be done in software, if the user provides
+    the amiibo keys. */
+
+#define CCR_NFC_IOCTL_ENCRYPT 1
+#define CCR_NFC_IOCTL_DECRYPT 2
+
+static NfpiiCryptBackend cryptBackend = NFPII_CRYPT_BACKEND_CCR_NFC;
+static AmiiboKeys amiiboKeys;
+static bool hasAmiiboKeys = false;
+
+/*  /dev/ccr_nfc expects the tag data in a different order than it's stored
+    on the tag. Every section is moved from rawOffset to cryptOffset before
+    encrypting/decrypting, and moved back afterwards. */
+
+struct CryptSection {
+    uint16_t rawOffset;
+    uint16_t cryptOffset;
+    uint16_t size;
+};
+
+static constexpr CryptSection cryptSections[] = {
+    { 0x000, 0x1d4, 0x008 },
+    { 0x008, 0x000, 0x008 },
+    { 0x010, 0x028, 0x004 },
+    { 0x014, 0x02c, 0x020 },
+    { 0x034, 0x1b4, 0x020 },
+    { 0x054, 0x1dc, 0x00c },
+    { 0x060, 0x1e8, 0x020 },
+    { 0x080, 0x008, 0x020 },
+    { 0x0a0, 0x04c, 0x168 },
+    { 0x208, 0x208, 0x014 },
+};
+
+// Offsets passed to /dev/ccr_nfc, relative to the crypt layout
+static constexpr uint32_t cryptOffsets[10] = {
+    0x208, 0x29, 0x1e8, 0x1d4, 0x2c, 0x188, 0x1dc, 0x0, 0x8, 0x1b4,
+};
+
+// Make sure every byte of the tag is moved exactly once in both directions
+static constexpr bool coversEveryByteOnce(bool useCryptOffset)
+{
+    for (uint32_t i = 0; i < sizeof(NTAGRawDataT2T); i++) {
+        int count = 0;
+        for (CryptSection const& section : cryptSections) {
+            uint32_t offset = useCryptOffset ? section.cryptOffset : section.rawOffset;
+            if (i >= offset && i < offset + section.size) {
+                count++;
+            }
+        }
+
+        if (count != 1) {
+            return false;
+        }
+    }
+
+    return true;
+}
+static_assert(coversEveryByteOnce(false), "Raw layout is not fully covered");
+static_assert(coversEveryByteOnce(true), "Crypt layout is not fully covered");
+
+static void rawDataToCryptData(const NTAGRawDataT2T* raw, NFCCryptData* crypt)
+{
+    crypt->version = raw->section1.formatVersion;
+    memcpy(crypt->offsets, cryptOffsets, sizeof(cryptOffsets));
+
+    const uint8_t* src = (const uint8_t*) raw;
+    for (CryptSection const& section : cryptSections) {
+        memcpy(crypt->data + section.cryptOffset, src + section.rawOffset, section.size);
+    }
+}
+
+static void cryptDataToRawData(const NFCCryptData* crypt, NTAGRawDataT2T* raw)
+{
+    uint8_t* dst = (uint8_t*) raw;
+    for (CryptSection const& section : cryptSections) {
+        memcpy(dst + section.rawOffset, crypt->data + section.cryptOffset, section.size);
+    }
+}
+
+static int openSessionLocked(NTAGCryptSession* session)
+{
+    if (session->handle >= 0) {
+        return 0;
+    }
+
+    int handle = IOS_Open("/dev/ccr_nfc", (IOSOpenMode) 0);
+    if (handle < 0) {
+        DEBUG_FUNCTION_LINE("Failed to open /dev/ccr_nfc: %d", handle);
+        return handle;
+    }
+
+    StatsIncrement(NFPII_STAT_CRYPT_SESSION_OPENS);
+    session->handle = handle;
+    return 0;
+}
+
+static void closeSessionLocked(NTAGCryptSession* session)
+{
+    if (session->handle >= 0) {
+        IOS_Close(session->handle);
+        session->handle = -1;
+    }
+}
+
+static int ccrNfcCryptData(NTAGCryptSession* session, uint32_t command, NFCCryptData* in, NFCCryptData* out)
+{
+    // Try twice, in case the handle became invalid
+    int res = -1;
+    for (int i = 0; i < 2; i++) {
+        res = openSessionLocked(session);
+        if (res < 0) {
+            break;
+        }
+
+        res = IOS_Ioctl(session->handle, command, in, sizeof(*in), out, sizeof(*out));
+        if (res >= 0) {
+            break;
+        }
+
+        // Reopen the device on the next attempt
+        closeSessionLocked(session);
+    }
+
+    return res;
+}
+
+static int softwareCryptData(uint32_t command, NFCCryptData* in, NFCCryptData* out)
+{
+    // Keep the header and the trailing lock and config bytes
+    out->version = in->version;
+    memcpy(out->offsets, in->offsets, sizeof(in->offsets));
+    memcpy(out->data + AMIIBO_CRYPT_DATA_SIZE, in->data + AMIIBO_CRYPT_DATA_SIZE, sizeof(in->data) - AMIIBO_CRYPT_DATA_SIZE);
+
+    if (command == CCR_NFC_IOCTL_DECRYPT) {
+        return AmiiboDecrypt(&amiiboKeys, in->data, out->data);
+    }
+
+    return AmiiboEncrypt(&amiiboKeys, in->data, out->data);
+}
+
+static int cryptData(NTAGCryptSession* session, uint32_t command, NFCCryptData* in, NFCCryptData* out)
+{
+    OSTime start = OSGetSystemTime();
+
+    int res;
+    if (cryptBackend == NFPII_CRYPT_BACKEND_SOFTWARE && hasAmiiboKeys) {
+        res = softwareCryptData(command, in, out);
+    } else {
+        if (cryptBackend == NFPII_CRYPT_BACKEND_SOFTWARE) {
+            DEBUG_FUNCTION_LINE("No amiibo keys loaded, falling back to /dev/ccr_nfc");
+        }
+
+        res = ccrNfcCryptData(session, command, in, out);
+    }
+
+    uint64_t us = OSTicksToMicroseconds(OSGetSystemTime() - start);
+    StatsIncrement(NFPII_STAT_CRYPT_CALLS);
+    StatsAdd(NFPII_STAT_CRYPT_TIME_US, us);
+    StatsSetMax(NFPII_STAT_CRYPT_MAX_TIME_US, us);
+
+    return res;
+}
+
+static int cryptGameData(NTAGCryptSession* session, uint32_t command, NTAGRawDataT2T* data)
+{
+    // Only support version 2
+    if (data->section1.formatVersion != 2) {
+        return -1;
+    }
+
+    // The session buffers are used for the conversion, so keep it locked
+    OSLockMutex(&session->mutex);
+
+    rawDataToCryptData(data, &session->inData);
+
+    // Let the backend do the actual encryption/decryption
+    int res = cryptData(session, command, &session->inData, &session->outData);
+    if (res >= 0) {
+        if (session->outData.version == 2) {
+            cryptDataToRawData(&session->outData, data);
+            res = 0;
+        } else {
+            res = -1;
+        }
+    }
+
+    OSUnlockMutex(&session->mutex);
+    return res;
+}
+
+static int decryptGameData(NTAGCryptSession* session, NTAGRawDataT2T* data)
+{
+    return cryptGameData(session, CCR_NFC_IOCTL_DECRYPT, data);
+}
+
+static int encryptGameData(NTAGCryptSession* session, NTAGRawDataT2T* data)
+{
+    return cryptGameData(session, CCR_NFC_IOCTL_ENCRYPT, data);
+}
+
+void NTAGInitCryptSession(NTAGCryptSession* session)
+{
+    OSInitMutex(&session->mutex);
+    session->handle = -1;
+}
+
+int NTAGOpenCryptSession(NTAGCryptSession* session)
+{
+    OSLockMutex(&session->mutex);
+    int res = openSessionLocked(session);
+    OSUnlockMutex(&session->mutex);
+    return res;
+}
+
+void NTAGCloseCryptSession(NTAGCryptSession* session)
+{
+    OSLockMutex(&session->mutex);
+    closeSessionLocked(session);
+    OSUnlockMutex(&session->mutex);
+}
+
+int NTAGDecrypt(NTAGCryptSession* session, NTAGDataT2T* data, NTAGRawDataT2T* raw)
+{
+    // Verify tag version
+    if (raw->section1.formatVersion != 2) {
+        DEBUG_FUNCTION_LINE("Invalid format version: %u", raw->section1.formatVersion);
+        return -1;
+    }
+
+    // Copy UID, set proto and tag type
+    data->tagInfo.uidSize = 0x7;
+    memcpy(data->tagInfo.uid, raw->uid, data->tagInfo.uidSize);
+    data->tagInfo.technology = NFC_TECHNOLOGY_A;
+    data->tagInfo.protocol = NFC_PROTOCOL_T2T;
+
+    // Verify lock and cfg bytes
+    if (raw->lockBytes[0] != 0x0f || raw->lockBytes[1] != 0xe0 || raw->dynamicLock[0] != 0x01
+       || raw->dynamicLock[1] != 0x00 || raw->dynamicLock[2] != 0x0f || raw->cfg0[0] != 0x00 
+       || raw->cfg0[1] != 0x00 || raw->cfg0[2] != 0x00 || raw->cfg0[3] != 0x04 || raw->cfg1[0] != 0x5f
+       || raw->cfg1[2] != 0x00 || raw->cfg1[3] != 0x00) {
+        DEBUG_FUNCTION_LINE("Invalid lock/cfg bit !");
+        return -1;
+    }
+
+    // Store raw data
+    data->raw.size = sizeof(NTAGRawDataT2T);
+    memcpy(&data->raw.data, raw, sizeof(NTAGRawDataT2T));
+
+    // Decrypt
+    int res = decryptGameData(session, raw);
+    if (res != 0) {
+        DEBUG_FUNCTION_LINE("Failed to decrypt data");
+        return res;
+    }
+
+    // Convert
+    data->info.figureVersion = raw->section0.figureVersion;
+    data->info.setupDate = raw->section0.setupDate;
+    data->info.magic = raw->section0.magic;
+    data->info.writes = raw->section0.writes;
+    data->info.flags = raw->section0.flags >> 4;
+    data->info.country = raw->section0.country;
+    data->info.fontRegion = raw->section0.flags & 0xf;
+    data->info.crcCounter = raw->section0.crcCounter;
+    data->info.lastWriteDate = raw->section0.lastWriteDate;
+    memcpy(&data->info.crc, &raw->section0.crc, sizeof(raw->section0.crc));
+    memcpy(data->info.name, raw->section0.name, sizeof(raw->section0.name));
+    data->info.accessID = raw->section2.accessID;
+    memcpy(data->info.characterID, raw->section1.characterID, sizeof(raw->section1.characterID));
+    data->info.figureType = raw->section1.figureType;
+    data->info.numberingID = raw->section1.numberingID;
+    data->info.seriesID = raw->section1.seriesID;
+    memcpy(&data->info.unknown, &raw->section1.unknown, sizeof(raw->section1.unknown));
+    memcpy(&data->info.mii, &raw->section2.mii, sizeof(raw->section2.mii));
+    data->info.titleID = raw->section2.titleID;
+    data->info.applicationAreaWrites = raw->section2.applicationAreaWrites;
+    memset(data->info.reserved, 0, sizeof(data->info.reserved));
+    memcpy(data->info.reserved, raw->section2.reserved, sizeof(raw->section2.reserved));
+    memset(data->appData.data, 0, sizeof(data->appData.data));
+    data->appData.size = 0xd8;
+    memcpy(data->appData.data, raw->applicationData, data->appData.size);
+    data->formatVersion = raw->section1.formatVersion;
+
+    return 0;
+}
+
+int NTAGEncrypt(NTAGCryptSession* session, NTAGRawDataT2T* raw, NTAGDataT2T* data)
+{
+#if 0 // not doing this anymore since NTAGConvertT2T does no error handling and also corrupts data sometimes?
+    // To encrypt we can simply call NTAGConvertT2T
+    NTAGDataT2T tmp;
+    memset(&tmp, 0, sizeof(tmp));
+
+    int res = NTAGConvertT2T(&tmp, data);
+    if (res != 0) {
+        DEBUG_FUNCTION_LINE("NTAGConvertT2T failed");
+        return res;
+    }
+
+    if (tmp.section1.version != 2) {
+        DEBUG_FUNCTION_LINE("Invalid format version");
+        return -1;
+    }
+
+    memcpy(raw, &data->rawData, sizeof(NTAGRawDataT2T));
+
+    // Copy over the individual modified sections
+    memcpy(&raw->section0, &tmp.rawData.section0, sizeof(raw->section0));
+    memcpy(&raw->section1, &tmp.rawData.section1, sizeof(raw->section1));
+    memcpy(&raw->section2, &tmp.rawData.section2, sizeof(raw->section2));
+    memcpy(&raw->applicationData, &tmp.rawData.applicationData, sizeof(raw->applicationData));
+#endif
+
+    // Convert
+    memcpy(raw, &data->raw.data, sizeof(data->raw.data));
+    raw->section0.crcCounter = data->info.crcCounter;
+    raw->section0.magic = data->info.magic;
+    raw->section0.writes = data->info.writes;
+    raw->section0.country = data->info.country;
+    raw->section0.flags = (data->info.fontRegion & 0xf) | (data->info.flags << 4);
+    raw->section0.setupDate = data->info.setupDate;
+    raw->section0.figureVersion = data->info.figureVersion;
+    raw->section0.lastWriteDate = data->info.lastWriteDate;
+    memcpy(&raw->section0.crc, &data->info.crc, sizeof(data->info.crc));
+    raw->section2.accessID = data->info.accessID;
+    memcpy(raw->section0.name, data->info.name, sizeof(data->info.name));
+    memcpy(raw->section1.tagHmac, data->raw.data.section1.tagHmac, sizeof(data->raw.data.section1.tagHmac));
+    memcpy(raw->section1.characterID, data->info.characterID, sizeof(data->info.characterID));
+    raw->section1.numberingID = data->info.numberingID;
+    raw->section1.seriesID = data->info.seriesID;
+    raw->section1.figureType = data->info.figureType;
+    raw->section1.formatVersion = data->formatVersion;
+    memcpy(&raw->section1.unknown, &data->info.unknown, sizeof(data->info.unknown));
+    memcpy(raw->section1.keygenSalt, data->raw.data.section1.keygenSalt, sizeof(data->raw.data.section1.keygenSalt));
+    memcpy(raw->section1.dataHmac, data->raw.data.section1.dataHmac, sizeof(data->raw.data.section1.dataHmac));
+    memcpy(&raw->section2.mii, &data->info.mii, sizeof(data->info.mii));
+    raw->section2.titleID = data->info.titleID;
+    raw->section2.applicationAreaWrites = data->info.applicationAreaWrites;
+    memcpy(raw->section2.reserved, data->info.reserved, sizeof(raw->section2.reserved));
+    memcpy(raw, &data->raw.data, 0x10);
+    if (data->appData.size > 0xd8) {
+        return -1;
+    }
+    memcpy(raw->applicationData, data->appData.data, data->appData.size);
+
+    // Encrypt
+    int res = encryptGameData(session, raw);
+    if (res != 0) {
+        DEBUG_FUNCTION_LINE("Failed to encrypt data");
+        return res;
+    }
+
+    // Copy back ntag uid and lock bytes from original rawData
+    //memcpy(raw, &data->rawData, 0x10);
+    //memcpy(raw->dynamicLock, data->rawData.dynamicLock, 0x14);
+
+    return 0;
+}
+
+int NTAGLoadAmiiboKeys(const void* data, uint32_t size)
+{
+    if (AmiiboLoadKeys(&amiiboKeys, data, size) != 0) {
+        DEBUG_FUNCTION_LINE("Invalid amiibo keys");
+        hasAmiiboKeys = false;
+        return -1;
+    }
+
+    hasAmiiboKeys = true;
+    return 0;
+}
+
+bool NTAGHasAmiiboKeys(void)
+{
+    return hasAmiiboKeys;
+}
+
+void NTAGSetCryptBackend(NfpiiCryptBackend backend)
+{
+    cryptBackend = backend;
+}
+
+NfpiiCryptBackend NTAGGetCryptBackend(void)
+{
+    return cryptBackend;
+}
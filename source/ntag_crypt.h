@@ -1,14 +1,47 @@
 #pragma once
 
 #include <ntag/ntag.h>
+#include <nfpii.h>
+#include <coreinit/mutex.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-int NTAGDecrypt(NTAGDataT2T* data, NTAGRawDataT2T* raw);
+typedef struct NFCCryptData {
+    uint32_t version;
+    uint32_t offsets[10];
+    uint8_t data[0x21c];
+} NFCCryptData;
+WUT_CHECK_SIZE(NFCCryptData, 0x248);
 
-int NTAGEncrypt(NTAGRawDataT2T* raw, NTAGDataT2T* data);
+/*  Keeps /dev/ccr_nfc open between operations, instead of opening and
+    closing the device for every single encrypt/decrypt.
+    Also holds the ioctl buffers, so they don't need to be on the stack. */
+typedef struct NTAGCryptSession {
+    OSMutex mutex;
+    int32_t handle;
+    NFCCryptData inData __attribute__((aligned(0x40)));
+    NFCCryptData outData __attribute__((aligned(0x40)));
+} NTAGCryptSession;
+
+void NTAGInitCryptSession(NTAGCryptSession* session);
+
+int NTAGOpenCryptSession(NTAGCryptSession* session);
+
+void NTAGCloseCryptSession(NTAGCryptSession* session);
+
+int NTAGDecrypt(NTAGCryptSession* session, NTAGDataT2T* data, NTAGRawDataT2T* raw);
+
+int NTAGEncrypt(NTAGCryptSession* session, NTAGRawDataT2T* raw, NTAGDataT2T* data);
+
+int NTAGLoadAmiiboKeys(const void* data, uint32_t size);
+
+bool NTAGHasAmiiboKeys(void);
+
+void NTAGSetCryptBackend(NfpiiCryptBackend backend);
+
+NfpiiCryptBackend NTAGGetCryptBackend(void);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,76 @@
+#include "ActivationProfiles.hpp"
+#include "Lock.hpp"
+
+namespace re::nfpii {
+
+ActivationProfiles::ActivationProfiles()
+{
+    OSInitMutex(&mutex);
+    numEntries = 0;
+}
+
+ActivationProfiles::~ActivationProfiles()
+{
+}
+
+bool ActivationProfiles::Set(uint64_t titleId, NfpiiActivationProfile profile)
+{
+    if (profile >= NFPII_ACTIVATION_PROFILE_MAX) {
+        return false;
+    }
+
+    Lock lock(&mutex);
+
+    for (uint32_t i = 0; i < numEntries; i++) {
+        if (entries[i].titleId != titleId) {
+            continue;
+        }
+
+        if (profile == NFPII_ACTIVATION_PROFILE_INSTANT) {
+            // Move the last entry into the free spot
+            entries[i] = entries[--numEntries];
+        } else {
+            entries[i].profile = profile;
+        }
+
+        return true;
+    }
+
+    if (profile == NFPII_ACTIVATION_PROFILE_INSTANT) {
+        return true;
+    }
+
+    if (numEntries >= ACTIVATION_PROFILE_MAX_TITLES) {
+        return false;
+    }
+
+    entries[numEntries].titleId = titleId;
+    entries[numEntries].profile = profile;
+    numEntries++;
+
+    return true;
+}
+
+NfpiiActivationProfile ActivationProfiles::Get(uint64_t titleId)
+{
+    Lock lock(&mutex);
+
+    for (uint32_t i = 0; i < numEntries; i++) {
+        if (entries[i].titleId == titleId) {
+            return entries[i].profile;
+        }
+    }
+
+    return NFPII_ACTIVATION_PROFILE_INSTANT;
+}
+
+ActivationTiming const& ActivationProfiles::GetTiming(NfpiiActivationProfile profile)
+{
+    if (profile >= NFPII_ACTIVATION_PROFILE_MAX) {
+        return activationTimings[NFPII_ACTIVATION_PROFILE_INSTANT];
+    }
+
+    return activationTimings[profile];
+}
+
+} // namespace re::nfpii
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <nfpii.h>
+#include <coreinit/mutex.h>
+
+#include <cstdint>
+
+namespace re::nfpii {
+
+// Number of titles which can have a non-default activation profile
+#define ACTIVATION_PROFILE_MAX_TITLES 32
+
+// Timings used for an activation profile
+struct ActivationTiming {
+    // Time between starting detection and the tag being found
+    uint32_t activationDelayMs;
+    // Amiibo settings re-attach the tag this long after detection was stopped or the tag was unmounted
+    uint32_t stopReattachMs;
+    uint32_t unmountReattachMs;
+};
+
+// Indexed by NfpiiActivationProfile
+constexpr ActivationTiming activationTimings[] = {
+    // NFPII_ACTIVATION_PROFILE_INSTANT
+    { 0, 2000, 1500 },
+    // NFPII_ACTIVATION_PROFILE_HARDWARE, about as long as the GamePad takes to read a tag
+    { 500, 2000, 1500 },
+};
+static_assert(sizeof(activationTimings) / sizeof(activationTimings[0]) == NFPII_ACTIVATION_PROFILE_MAX,
+    "Every activation profile needs its timings");
+
+// Small table of activation profiles keyed by title id
+// Titles without an entry use NFPII_ACTIVATION_PROFILE_INSTANT
+class ActivationProfiles {
+public:
+    ActivationProfiles();
+    virtual ~ActivationProfiles();
+
+    // Setting NFPII_ACTIVATION_PROFILE_INSTANT removes the entry, returns false if the table is full
+    bool Set(uint64_t titleId, NfpiiActivationProfile profile);
+    NfpiiActivationProfile Get(uint64_t titleId);
+
+    static ActivationTiming const& GetTiming(NfpiiActivationProfile profile);
+
+private:
+    struct Entry {
+        uint64_t titleId;
+        NfpiiActivationProfile profile;
+    };
+
+    OSMutex mutex;
+    uint32_t numEntries;
+    Entry entries[ACTIVATION_PROFILE_MAX_TITLES];
+};
+
+} // namespace re::nfpii
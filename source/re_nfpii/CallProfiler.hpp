@@ -0,0 +1,23 @@
+#pragma once
+
+#include "utils/stats.h"
+
+#include <coreinit/time.h>
+
+// Records how long an nn::nfp call took once it goes out of scope
+class CallProfiler {
+public:
+    CallProfiler(NfpiiCall call)
+     : call(call), start(OSGetSystemTime())
+    {
+    }
+
+    ~CallProfiler()
+    {
+        StatsRecordCall(call, OSTicksToMicroseconds(OSGetSystemTime() - start));
+    }
+
+private:
+    NfpiiCall call;
+    OSTime start;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <coreinit/time.h>
+#include <coreinit/atomic64.h>
+
+namespace re::nfpii {
+
+// Source of the time used for the tag timeouts and the dates written to tags
+class Clock {
+public:
+    virtual ~Clock()
+    {
+    }
+
+    virtual OSTime GetTime() = 0;
+};
+
+class SystemClock : public Clock {
+public:
+    OSTime GetTime() override
+    {
+        return OSGetTime();
+    }
+};
+
+// Only moves when advanced, so long sessions and timeouts can be simulated quickly
+class VirtualClock : public Clock {
+public:
+    VirtualClock()
+     : time(0)
+    {
+    }
+
+    OSTime GetTime() override
+    {
+        return (OSTime) OSGetAtomic64(&time);
+    }
+
+    void SetTime(OSTime time)
+    {
+        OSSetAtomic64(&this->time, (uint64_t) time);
+    }
+
+    void Advance(OSTime ticks)
+    {
+        OSAddAtomic64(&time, (uint64_t) ticks);
+    }
+
+private:
+    volatile uint64_t time;
+};
+
+} // namespace re::nfpii
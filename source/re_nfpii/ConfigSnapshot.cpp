@@ -0,0 +1,112 @@
+#include "ConfigSnapshot.hpp"
+
+#include <cstring>
+
+namespace re::nfpii {
+
+ConfigSnapshot::ConfigSnapshot()
+{
+    OSInitMutex(&writeMutex);
+    sequence.store(0);
+
+    for (Values& v : values) {
+        v.emulationState = NFPII_EMULATION_OFF;
+        v.emulationStateChanges = 0;
+        v.uuidRandomizationState = NFPII_RANDOMIZATION_OFF;
+        v.removeAfterSeconds = 0.0f;
+        v.tagEmulationPath[0] = '\0';
+    }
+
+    stableTagEmulationPath[0] = '\0';
+}
+
+ConfigSnapshot::~ConfigSnapshot()
+{
+}
+
+void ConfigSnapshot::SetEmulationState(NfpiiEmulationState state)
+{
+    Values* v = BeginWrite();
+    v->emulationState = state;
+    v->emulationStateChanges++;
+    EndWrite();
+}
+
+void ConfigSnapshot::SetUUIDRandomizationState(NfpiiUUIDRandomizationState state)
+{
+    Values* v = BeginWrite();
+    v->uuidRandomizationState = state;
+    EndWrite();
+}
+
+void ConfigSnapshot::SetRemoveAfterSeconds(float secs)
+{
+    Values* v = BeginWrite();
+    v->removeAfterSeconds = secs;
+    EndWrite();
+}
+
+void ConfigSnapshot::SetTagEmulationPath(const char* path)
+{
+    Values* v = BeginWrite();
+    strncpy(v->tagEmulationPath, path, sizeof(v->tagEmulationPath) - 1);
+    v->tagEmulationPath[sizeof(v->tagEmulationPath) - 1] = '\0';
+    memcpy(stableTagEmulationPath, v->tagEmulationPath, sizeof(stableTagEmulationPath));
+    EndWrite();
+}
+
+uint32_t ConfigSnapshot::Read(Values* outValues) const
+{
+    while (true) {
+        uint32_t seq = sequence.load(std::memory_order_acquire);
+        memcpy(outValues, &values[seq & 1], sizeof(Values));
+
+        // If the writer published twice while copying, the copy might be torn
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == seq) {
+            return seq;
+        }
+    }
+}
+
+NfpiiEmulationState ConfigSnapshot::GetEmulationState() const
+{
+    Values v;
+    Read(&v);
+    return v.emulationState;
+}
+
+NfpiiUUIDRandomizationState ConfigSnapshot::GetUUIDRandomizationState() const
+{
+    Values v;
+    Read(&v);
+    return v.uuidRandomizationState;
+}
+
+std::string ConfigSnapshot::GetTagEmulationPath() const
+{
+    // The copy might be overwritten by the next publish, so never return a pointer into it
+    Values v;
+    Read(&v);
+    return v.tagEmulationPath;
+}
+
+ConfigSnapshot::Values* ConfigSnapshot::BeginWrite()
+{
+    OSLockMutex(&writeMutex);
+
+    uint32_t seq = sequence.load(std::memory_order_relaxed);
+    Values* next = &values[(seq + 1) & 1];
+    memcpy(next, &values[seq & 1], sizeof(Values));
+
+    return next;
+}
+
+void ConfigSnapshot::EndWrite()
+{
+    sequence.fetch_add(1, std::memory_order_release);
+
+    OSUnlockMutex(&writeMutex);
+}
+
+} // namespace re::nfpii
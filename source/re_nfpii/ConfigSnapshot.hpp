@@ -0,0 +1,70 @@
+#pragma once
+
+#include <nfpii.h>
+#include <coreinit/mutex.h>
+
+#include <atomic>
+#include <string>
+
+namespace re::nfpii {
+
+// Max length of the tag emulation path, including the terminator
+#define CONFIG_MAX_PATH 0x280
+
+// Configuration set through the Nfpii exports
+// The plugin writes into the inactive copy and then publishes it by bumping the sequence,
+// so readers never have to take a lock which could block the plugin
+class ConfigSnapshot {
+public:
+    struct Values {
+        NfpiiEmulationState emulationState;
+        // Incremented on every SetEmulationState, since setting the same state again still matters
+        uint32_t emulationStateChanges;
+        NfpiiUUIDRandomizationState uuidRandomizationState;
+        float removeAfterSeconds;
+        char tagEmulationPath[CONFIG_MAX_PATH];
+    };
+
+    ConfigSnapshot();
+    virtual ~ConfigSnapshot();
+
+    void SetEmulationState(NfpiiEmulationState state);
+    void SetUUIDRandomizationState(NfpiiUUIDRandomizationState state);
+    void SetRemoveAfterSeconds(float secs);
+    void SetTagEmulationPath(const char* path);
+
+    uint32_t GetSequence() const
+    {
+        return sequence.load(std::memory_order_acquire);
+    }
+
+    // Copies the currently published values and returns their sequence
+    uint32_t Read(Values* outValues) const;
+
+    // Single field accessors of the published values, these go through Read as well
+    NfpiiEmulationState GetEmulationState() const;
+    NfpiiUUIDRandomizationState GetUUIDRandomizationState() const;
+    std::string GetTagEmulationPath() const;
+
+    // Path which is only overwritten by the next SetTagEmulationPath, so it can be handed out as a pointer
+    const char* GetStableTagEmulationPath() const
+    {
+        return stableTagEmulationPath;
+    }
+
+private:
+    // Prepares the inactive copy with the current values
+    Values* BeginWrite();
+    void EndWrite();
+
+    // Only serializes writers
+    OSMutex writeMutex;
+
+    std::atomic<uint32_t> sequence;
+    Values values[2];
+
+    // Protected by writeMutex
+    char stableTagEmulationPath[CONFIG_MAX_PATH];
+};
+
+} // namespace re::nfpii
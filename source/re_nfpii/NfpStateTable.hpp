@@ -0,0 +1,114 @@
+#pragma once
+
+#include <nn/nfp.h>
+#include <cstdint>
+
+namespace re::nfpii {
+using namespace nn::nfp;
+
+constexpr uint32_t NfpStateBit(NfpState state)
+{
+    return 1u << (uint32_t) state;
+}
+
+template<typename... States>
+constexpr uint32_t NfpStateMask(States... states)
+{
+    return (NfpStateBit(states) | ... | 0u);
+}
+
+// States in which a tag is presented to the application
+constexpr uint32_t NFP_STATES_TAG_ACTIVE = NfpStateMask(NfpState::Found, NfpState::Mounted, NfpState::MountedROM);
+
+// Operations which are only allowed in some states
+enum class NfpOperation : uint32_t {
+    Initialize,
+    SetEvent,
+    StartDetection,
+    StopDetection,
+    Mount,
+    Unmount,
+    Restore,
+    Format,
+    // Everything which needs a writable mount: app areas, register info, admin info, streams, flush
+    AccessMounted,
+    GetReadOnlyInfo,
+    GetRomInfo,
+    GetTagInfo,
+    LoadTag,
+
+    Max,
+};
+
+// States each operation is allowed in, indexed by NfpOperation
+constexpr uint32_t nfpOperationStates[] = {
+    // Initialize
+    NfpStateMask(NfpState::Uninitialized),
+    // SetEvent
+    NfpStateMask(NfpState::Initialized),
+    // StartDetection
+    NfpStateMask(NfpState::Initialized, NfpState::Removed),
+    // StopDetection
+    NfpStateMask(NfpState::Searching, NfpState::Removed) | NFP_STATES_TAG_ACTIVE,
+    // Mount
+    NfpStateMask(NfpState::Found),
+    // Unmount
+    NfpStateMask(NfpState::Mounted, NfpState::MountedROM),
+    // Restore
+    NfpStateMask(NfpState::Found),
+    // Format
+    NfpStateMask(NfpState::Found),
+    // AccessMounted
+    NfpStateMask(NfpState::Mounted),
+    // GetReadOnlyInfo
+    NfpStateMask(NfpState::Found, NfpState::Mounted),
+    // GetRomInfo
+    NfpStateMask(NfpState::Mounted, NfpState::MountedROM),
+    // GetTagInfo
+    NFP_STATES_TAG_ACTIVE,
+    // LoadTag
+    NfpStateMask(NfpState::Searching),
+};
+static_assert(sizeof(nfpOperationStates) / sizeof(nfpOperationStates[0]) == (uint32_t) NfpOperation::Max,
+    "Every operation needs its allowed states");
+
+constexpr bool IsNfpStateAllowed(NfpOperation op, NfpState state)
+{
+    return nfpOperationStates[(uint32_t) op] & NfpStateBit(state);
+}
+
+// States which can be entered from each state, indexed by NfpState
+constexpr uint32_t nfpStateTransitions[] = {
+    // Uninitialized
+    NfpStateMask(NfpState::Initialized),
+    // Initialized
+    NfpStateMask(NfpState::Uninitialized, NfpState::Searching),
+    // Searching
+    NfpStateMask(NfpState::Uninitialized, NfpState::Initialized, NfpState::Found),
+    // Found
+    NfpStateMask(NfpState::Uninitialized, NfpState::Initialized, NfpState::Removed, NfpState::Mounted, NfpState::MountedROM),
+    // Removed
+    NfpStateMask(NfpState::Uninitialized, NfpState::Initialized, NfpState::Searching),
+    // Mounted
+    NfpStateMask(NfpState::Uninitialized, NfpState::Initialized, NfpState::Found),
+    // Unknown6
+    0,
+    // MountedROM
+    NfpStateMask(NfpState::Uninitialized, NfpState::Initialized, NfpState::Found),
+};
+static_assert(sizeof(nfpStateTransitions) / sizeof(nfpStateTransitions[0]) == (uint32_t) NfpState::MountedROM + 1,
+    "Every state needs its transitions");
+
+constexpr bool IsNfpStateTransitionAllowed(NfpState from, NfpState to)
+{
+    return (uint32_t) from <= (uint32_t) NfpState::MountedROM && (nfpStateTransitions[(uint32_t) from] & NfpStateBit(to));
+}
+
+// Sanity checks for the usual detection and mount sequence
+static_assert(IsNfpStateTransitionAllowed(NfpState::Initialized, NfpState::Searching));
+static_assert(IsNfpStateTransitionAllowed(NfpState::Searching, NfpState::Found));
+static_assert(IsNfpStateTransitionAllowed(NfpState::Found, NfpState::Mounted));
+static_assert(!IsNfpStateTransitionAllowed(NfpState::Searching, NfpState::Mounted));
+static_assert(IsNfpStateAllowed(NfpOperation::GetTagInfo, NfpState::MountedROM));
+
+} // namespace re::nfpii
@@ -19,6 +19,8 @@ Tag::Tag()
     updateTitleId = false;
     updateAppWriteCount = false;
     memset(&ntagData, 0, sizeof(ntagData));
+    native = false;
+    infoCacheValid = false;
 }
 
 Tag::~Tag()
@@ -28,6 +30,7 @@ Tag::~Tag()
 Result Tag::SetData(NTAGDataT2T* data)
 {
     memmove(&ntagData, data, sizeof(NTAGDataT2T));
+    InvalidateInfoCache();
     return NFP_SUCCESS;
 }
 
@@ -54,6 +57,8 @@ Result Tag::Mount(bool backup)
     updateTitleId = false;
     updateAppWriteCount = false;
 
+    UpdateInfoCache();
+
     return NFP_SUCCESS;
 }
 
@@ -120,7 +125,7 @@ Result Tag::Write(TagInfo* info, bool update)
             SetUuidCRC(&ntagData.info.crc);
         }
 
-        ntagData.info.lastWriteDate = OSTimeToAmiiboTime(OSGetTime());
+        ntagData.info.lastWriteDate = OSTimeToAmiiboTime(tagManager.GetTime());
     }
 
     Result res = WriteTag(true);
@@ -130,9 +135,12 @@ Result Tag::Write(TagInfo* info, bool update)
         ntagData.info.titleID = currentTitleId;
         ntagData.info.writes = currentWrites;
         ntagData.info.applicationAreaWrites = currentApplicationAreaWrites;
+        InvalidateInfoCache();
         return res;
     }
 
+    UpdateInfoCache();
+
     return NFP_SUCCESS;
 }
 
@@ -171,6 +179,7 @@ Result Tag::ReadDataBuffer(void* out, int32_t offset, uint32_t size)
 void Tag::ClearTagData()
 {
     memset(&ntagData, 0, sizeof(ntagData));
+    InvalidateInfoCache();
 }
 
 Result Tag::CreateApplicationArea(NTAGDataT2T* data, ApplicationAreaCreateInfo const& createInfo)
@@ -199,6 +208,7 @@ Result Tag::CreateApplicationArea(NTAGDataT2T* data, ApplicationAreaCreateInfo c
 
     // Move data into working buffer
     memmove(&ntagData, data, sizeof(NTAGDataT2T));
+    InvalidateInfoCache();
 
     updateTitleId = true;
     ntagData.info.accessID = createInfo.accessID;
@@ -224,6 +234,7 @@ Result Tag::CreateApplicationArea(NTAGDataT2T* data, ApplicationAreaCreateInfo c
     if (res.IsFailure()) {
         // Restore the backed up state, if writing failed
         memcpy(&ntagData, &backupData, sizeof(NTAGDataT2T));
+        InvalidateInfoCache();
         return res;
     }
 
@@ -250,13 +261,16 @@ Result Tag::SetRegisterInfo(RegisterInfoSet const& info)
 
     // If we don't have any register info yet, write setup date
     if (!HasRegisterInfo()) {
-        ntagData.info.setupDate = OSTimeToAmiiboTime(OSGetTime());
+        ntagData.info.setupDate = OSTimeToAmiiboTime(tagManager.GetTime());
         updateAppWriteCount = true;
     }
 
     // Set "has register info" bit
     ntagData.info.flags |= (uint8_t) AdminFlags::IsRegistered;
 
+    // The register info is visible before the tag is flushed
+    InvalidateInfoCache();
+
     return NFP_SUCCESS;
 }
 
@@ -275,12 +289,14 @@ Result Tag::DeleteApplicationArea()
     // Delete app area and increase write count
     ClearApplicationArea(&ntagData);
     ntagData.info.writes = IncreaseCount(ntagData.info.writes, true);
+    InvalidateInfoCache();
 
     // Write the data to the tag
     Result res = Write(&tagInfo, true);
     if (res.IsFailure()) {
         // Restore the backed up state, if writing failed
         memcpy(&ntagData, &backupData, sizeof(NTAGDataT2T));
+        InvalidateInfoCache();
         return res;
     }
 
@@ -305,12 +321,14 @@ Result Tag::DeleteRegisterInfo()
     // Delete register info and increase write count
     ClearRegisterInfo(&ntagData);
     ntagData.info.writes = IncreaseCount(ntagData.info.writes, true);
+    InvalidateInfoCache();
 
     // Write the data to the tag
     Result res = Write(&tagInfo, true);
     if (res.IsFailure()) {
         // Restore the backed up state, if writing failed
         memcpy(&ntagData, &backupData, sizeof(NTAGDataT2T));
+        InvalidateInfoCache();
         return res;
     }
 
@@ -358,9 +376,15 @@ Result Tag::Format(NTAGDataT2T* data, const void* appData, int32_t appDataSize)
         GetRandom(ntagData.appData.data + appDataSize, 0xd8 - appDataSize);
     }
     ntagData.appData.size = 0xd8;
+    InvalidateInfoCache();
 
     // nfp also updates some backup state here, but we don't emulate that yet
-    return WriteTag(false);
+    Result res = WriteTag(false);
+    if (res.IsSuccess()) {
+        UpdateInfoCache();
+    }
+
+    return res;
 }
 
 bool Tag::HasRegisterInfo()
@@ -391,23 +415,70 @@ Result Tag::WriteTag(bool backup)
     // nfp usually writes to the tag using NTAG here
     // this code is mostly custom and writes the data to the SD instead
 
-    NTAGRawDataT2T raw;
-    if (NTAGEncrypt(&raw, GetData()) != 0) {
-        return NFP_STATUS_RESULT(0x12345);
+    // The writer thread encrypts and writes a snapshot of the data in the background
+    tagManager.GetTagWriter().Queue(path, &ntagData, native);
+
+    // The tag was rewritten, refresh the tag info used for NFCGetTagInfo
+    tagManager.UpdateNFCTagInfo(path, &ntagData);
+
+    return NFP_SUCCESS;
+}
+
+void Tag::GetTagInfo(TagInfo* info)
+{
+    if (!infoCacheValid) {
+        UpdateInfoCache();
     }
 
-    int res = FSUtils::WriteToFile(path.c_str(), &raw, sizeof(raw));
-    if (res != sizeof(raw)) {
-        DEBUG_FUNCTION_LINE("Failed to write tag data to %s: %x", path.c_str(), res);
-        LogHandler::Error("Failed to write tag data to %s: %x", path.c_str(), res);
+    memcpy(info, &cachedTagInfo, sizeof(TagInfo));
+}
 
-        return NFP_STATUS_RESULT(0x12345);
+void Tag::GetCommonInfo(CommonInfo* info)
+{
+    if (!infoCacheValid) {
+        UpdateInfoCache();
     }
 
-    // copy the new encrypted raw data to the raw part
-    memcpy(&ntagData.raw.data, &raw, sizeof(raw));
+    memcpy(info, &cachedCommonInfo, sizeof(CommonInfo));
+}
 
-    return NFP_SUCCESS;
+void Tag::GetRegisterInfo(RegisterInfo* info)
+{
+    if (!infoCacheValid) {
+        UpdateInfoCache();
+    }
+
+    memcpy(info, &cachedRegisterInfo, sizeof(RegisterInfo));
+}
+
+void Tag::GetReadOnlyInfo(ReadOnlyInfo* info)
+{
+    if (!infoCacheValid) {
+        UpdateInfoCache();
+    }
+
+    memcpy(info, &cachedReadOnlyInfo, sizeof(ReadOnlyInfo));
+}
+
+void Tag::GetAdminInfo(AdminInfo* info)
+{
+    if (!infoCacheValid) {
+        UpdateInfoCache();
+    }
+
+    memcpy(info, &cachedAdminInfo, sizeof(AdminInfo));
+}
+
+void Tag::UpdateInfoCache()
+{
+    memset(&cachedTagInfo, 0, sizeof(TagInfo));
+    ReadTagInfo(&cachedTagInfo, &ntagData);
+    ReadCommonInfo(&cachedCommonInfo, &ntagData);
+    ReadRegisterInfo(&cachedRegisterInfo, &ntagData);
+    ReadReadOnlyInfo(&cachedReadOnlyInfo, &ntagData);
+    ReadAdminInfo(&cachedAdminInfo, &ntagData);
+
+    infoCacheValid = true;
 }
 
 } // namespace re::nfpii
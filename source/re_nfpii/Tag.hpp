@@ -63,10 +63,26 @@ public:
     Result WriteTag(bool backup);
 
 public: // custom
-    void SetPath(std::string& path) {
+    void SetPath(std::string const& path) {
         this->path = path;
     }
 
+    std::string const& GetPath() const {
+        return path;
+    }
+
+    void SetNative(bool native) {
+        this->native = native;
+    }
+
+    // These return copies of the info projected from the tag data,
+    // which is only recomputed after the data has changed
+    void GetTagInfo(TagInfo* info);
+    void GetCommonInfo(CommonInfo* info);
+    void GetRegisterInfo(RegisterInfo* info);
+    void GetReadOnlyInfo(ReadOnlyInfo* info);
+    void GetAdminInfo(AdminInfo* info);
+
 private:
     // +0x4
     uint8_t dataBuffer[0x800];
@@ -82,7 +98,21 @@ private:
     bool updateTitleId;
 
 private: // custom
+    void UpdateInfoCache();
+
+    void InvalidateInfoCache() {
+        infoCacheValid = false;
+    }
+
     std::string path;
+    bool native;
+
+    bool infoCacheValid;
+    TagInfo cachedTagInfo;
+    CommonInfo cachedCommonInfo;
+    RegisterInfo cachedRegisterInfo;
+    ReadOnlyInfo cachedReadOnlyInfo;
+    AdminInfo cachedAdminInfo;
 };
 
 } // namespace re::nfpii
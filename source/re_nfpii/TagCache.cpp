@@ -0,0 +1,112 @@
+#include "TagCache.hpp"
+#include "Lock.hpp"
+#include "utils/stats.h"
+
+#include <cstring>
+
+namespace re::nfpii {
+
+TagCache::TagCache()
+{
+    OSInitMutex(&mutex);
+    useCounter = 0;
+
+    for (Entry& e : entries) {
+        e.valid = false;
+        e.lastUse = 0;
+        e.size = 0;
+        e.modified = 0;
+        e.native = false;
+        memset(&e.data, 0, sizeof(e.data));
+    }
+}
+
+TagCache::~TagCache()
+{
+}
+
+bool TagCache::Get(std::string const& path, FSAStat const& stat, NTAGDataT2T* outData, bool* outNative)
+{
+    Lock lock(&mutex);
+
+    Entry* e = Find(path);
+    if (!e) {
+        StatsIncrement(NFPII_STAT_TAG_CACHE_MISSES);
+        return false;
+    }
+
+    // File was modified since it was cached
+    if (e->size != stat.size || e->modified != (uint64_t) stat.modified) {
+        e->valid = false;
+        StatsIncrement(NFPII_STAT_TAG_CACHE_MISSES);
+        return false;
+    }
+
+    memcpy(outData, &e->data, sizeof(NTAGDataT2T));
+    *outNative = e->native;
+    e->lastUse = ++useCounter;
+
+    StatsIncrement(NFPII_STAT_TAG_CACHE_HITS);
+    return true;
+}
+
+void TagCache::Put(std::string const& path, FSAStat const& stat, const NTAGDataT2T* data, bool native)
+{
+    Lock lock(&mutex);
+
+    Entry* e = Find(path);
+    if (!e) {
+        // Use a free entry or evict the least recently used one
+        e = &entries[0];
+        for (Entry& entry : entries) {
+            if (!entry.valid) {
+                e = &entry;
+                break;
+            }
+
+            if (entry.lastUse < e->lastUse) {
+                e = &entry;
+            }
+        }
+    }
+
+    e->valid = true;
+    e->lastUse = ++useCounter;
+    e->path = path;
+    e->size = stat.size;
+    e->modified = (uint64_t) stat.modified;
+    e->native = native;
+    memcpy(&e->data, data, sizeof(NTAGDataT2T));
+}
+
+void TagCache::Invalidate(std::string const& path)
+{
+    Lock lock(&mutex);
+
+    Entry* e = Find(path);
+    if (e) {
+        e->valid = false;
+    }
+}
+
+void TagCache::Clear()
+{
+    Lock lock(&mutex);
+
+    for (Entry& e : entries) {
+        e.valid = false;
+    }
+}
+
+TagCache::Entry* TagCache::Find(std::string const& path)
+{
+    for (Entry& e : entries) {
+        if (e.valid && e.path == path) {
+            return &e;
+        }
+    }
+
+    return nullptr;
+}
+
+} // namespace re::nfpii
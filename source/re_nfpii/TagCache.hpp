@@ -0,0 +1,46 @@
+#pragma once
+
+#include <ntag/ntag.h>
+#include <coreinit/mutex.h>
+#include <coreinit/filesystem_fsa.h>
+
+#include <string>
+
+namespace re::nfpii {
+
+// Number of decrypted tags which are kept around
+#define TAG_CACHE_NUM_ENTRIES 4
+
+// Small LRU cache of decrypted tag data
+// Entries are keyed by path and only considered valid while the size and
+// modification time of the file on the SD still match
+class TagCache {
+public:
+    TagCache();
+    virtual ~TagCache();
+
+    bool Get(std::string const& path, FSAStat const& stat, NTAGDataT2T* outData, bool* outNative);
+    void Put(std::string const& path, FSAStat const& stat, const NTAGDataT2T* data, bool native);
+
+    void Invalidate(std::string const& path);
+    void Clear();
+
+private:
+    struct Entry {
+        bool valid;
+        uint32_t lastUse;
+        std::string path;
+        uint32_t size;
+        uint64_t modified;
+        bool native;
+        NTAGDataT2T data;
+    };
+
+    Entry* Find(std::string const& path);
+
+    OSMutex mutex;
+    uint32_t useCounter;
+    Entry entries[TAG_CACHE_NUM_ENTRIES];
+};
+
+} // namespace re::nfpii
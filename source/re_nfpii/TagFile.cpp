@@ -0,0 +1,152 @@
+#include "TagFile.hpp"
+#include "re_nfpii.hpp"
+#include "debug/logger.h"
+#include "utils/FSUtils.hpp"
+#include "utils/LogHandler.hpp"
+
+#include <cstring>
+
+namespace re::nfpii {
+
+static bool IsValidTagInfo(const NFCTagInfo* info)
+{
+    // The uid is copied into fixed size buffers and handed to the game as is
+    return info->uidSize <= sizeof(info->uid);
+}
+
+static bool IsValidNativeData(const NTAGDataT2T* data)
+{
+    // Native tags skip the checks of NTAGDecrypt, so make sure they contain what decrypting would produce
+    return IsValidTagInfo(&data->tagInfo) && data->formatVersion == 2 && data->appData.size <= sizeof(data->appData.data)
+        && data->raw.size == sizeof(NTAGRawDataT2T);
+}
+
+Result ReadTagFile(NTAGCryptSession* session, const char* path, NTAGDataT2T* outData, bool* outNative)
+{
+    // Raw dumps are smaller than native tags, so this can hold both
+    __attribute__((aligned(0x40))) union {
+        NTAGRawDataT2T raw;
+        NativeTag native;
+    } file;
+
+    int res = FSUtils::ReadFromFile(path, &file, sizeof(file));
+    if (res >= (int) sizeof(NativeTagHeader) && file.native.header.magic == NATIVE_TAG_MAGIC) {
+        if (file.native.header.version != NATIVE_TAG_VERSION || file.native.header.headerSize != sizeof(NativeTagHeader)
+           || file.native.header.dataSize != sizeof(NTAGDataT2T) || res != sizeof(NativeTag)
+           || !IsValidNativeData(&file.native.data)) {
+            DEBUG_FUNCTION_LINE("Invalid native tag %s", path);
+            LogHandler::Error("Invalid native tag %s", path);
+            return NFP_STATUS_RESULT(0x12345);
+        }
+
+        memcpy(outData, &file.native.data, sizeof(NTAGDataT2T));
+        *outNative = true;
+        return NFP_SUCCESS;
+    }
+
+    // We need at least everything up to the config bytes
+    if (res < 0x214) {
+        DEBUG_FUNCTION_LINE("Failed to read tag data from %s: %x", path, res);
+        LogHandler::Error("Failed to read tag data from %s: %x", path, res);
+        return NFP_STATUS_RESULT(0x12345);
+    }
+
+    // Decrypt the tag
+    if (NTAGDecrypt(session, outData, &file.raw) != 0) {
+        DEBUG_FUNCTION_LINE("Failed to parse tag");
+        LogHandler::Error("Failed to parse tag");
+        return NFP_STATUS_RESULT(0x12345);
+    }
+
+    *outNative = false;
+    return NFP_SUCCESS;
+}
+
+Result ReadTagFileInfo(const char* path, NFCTagInfo* outInfo)
+{
+    // The tag info directly follows the header for native tags
+    __attribute__((aligned(0x40))) struct {
+        NativeTagHeader header;
+        NFCTagInfo tagInfo;
+    } file;
+
+    int res = FSUtils::ReadFromFile(path, &file, sizeof(file));
+    if (res == sizeof(file) && file.header.magic == NATIVE_TAG_MAGIC) {
+        if (!IsValidTagInfo(&file.tagInfo)) {
+            LogHandler::Error("Invalid native tag %s", path);
+            return NFP_STATUS_RESULT(0x12345);
+        }
+
+        memcpy(outInfo, &file.tagInfo, sizeof(NFCTagInfo));
+        return NFP_SUCCESS;
+    }
+
+    // Raw dumps start with the UID
+    if (res < 7) {
+        return NFP_STATUS_RESULT(0x12345);
+    }
+
+    memset(outInfo, 0, sizeof(NFCTagInfo));
+    outInfo->uidSize = 7;
+    memcpy(outInfo->uid, &file, outInfo->uidSize);
+    outInfo->technology = NFC_TECHNOLOGY_A;
+    outInfo->protocol = NFC_PROTOCOL_T2T;
+    return NFP_SUCCESS;
+}
+
+Result EncodeTagFile(NTAGCryptSession* session, NTAGDataT2T* data, bool native, void* outFile, uint32_t* outSize)
+{
+    if (native) {
+        NativeTag* file = (NativeTag*) outFile;
+        file->header.magic = NATIVE_TAG_MAGIC;
+        file->header.version = NATIVE_TAG_VERSION;
+        file->header.headerSize = sizeof(NativeTagHeader);
+        file->header.dataSize = sizeof(NTAGDataT2T);
+        file->header.reserved = 0;
+        memcpy(&file->data, data, sizeof(NTAGDataT2T));
+
+        *outSize = sizeof(NativeTag);
+        return NFP_SUCCESS;
+    }
+
+    NTAGRawDataT2T* raw = (NTAGRawDataT2T*) outFile;
+    if (NTAGEncrypt(session, raw, data) != 0) {
+        return NFP_STATUS_RESULT(0x12345);
+    }
+
+    // copy the new encrypted raw data to the raw part
+    memcpy(&data->raw.data, raw, sizeof(NTAGRawDataT2T));
+
+    *outSize = sizeof(NTAGRawDataT2T);
+    return NFP_SUCCESS;
+}
+
+Result WriteTagFile(NTAGCryptSession* session, const char* path, NTAGDataT2T* data, bool native)
+{
+    __attribute__((aligned(0x40))) union {
+        NTAGRawDataT2T raw;
+        NativeTag native;
+    } file;
+
+    uint32_t size;
+    Result res = EncodeTagFile(session, data, native, &file, &size);
+    if (res.IsFailure()) {
+        return res;
+    }
+
+    return WriteTagFileData(path, &file, size);
+}
+
+Result WriteTagFileData(const char* path, const void* file, uint32_t size)
+{
+    int res = FSUtils::WriteToFile(path, file, size);
+    if (res != (int) size) {
+        DEBUG_FUNCTION_LINE("Failed to write tag data to %s: %x", path, res);
+        LogHandler::Error("Failed to write tag data to %s: %x", path, res);
+        return NFP_STATUS_RESULT(0x12345);
+    }
+
+    return NFP_SUCCESS;
+}
+
+} // namespace re::nfpii
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <nn/nfp.h>
+#include <ntag/ntag.h>
+
+#include "ntag_crypt.h"
+
+namespace re::nfpii {
+using nn::Result;
+using namespace nn::nfp;
+
+// 'NFPN'
+#define NATIVE_TAG_MAGIC 0x4e46504e
+#define NATIVE_TAG_VERSION 1
+
+// Header of the native tag format
+// Native tags store the already decrypted tag data, so loading and writing
+// them doesn't require any crypto. The original raw data is kept as well,
+// so the tag can be converted back to an encrypted dump.
+struct NativeTagHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint32_t dataSize;
+    uint32_t reserved;
+};
+WUT_CHECK_SIZE(NativeTagHeader, 0x10);
+
+struct NativeTag {
+    NativeTagHeader header;
+    NTAGDataT2T data;
+};
+
+// Maximum size of a tag file in any of the formats
+#define TAG_FILE_MAX_SIZE sizeof(NativeTag)
+
+// Reads a tag from path, which can either be a raw dump or a native tag
+Result ReadTagFile(NTAGCryptSession* session, const char* path, NTAGDataT2T* outData, bool* outNative);
+
+// Only reads the NFC tag info (UID, technology and protocol) of the tag at path
+Result ReadTagFileInfo(const char* path, NFCTagInfo* outInfo);
+
+// Converts data to the contents of a native or raw tag file
+// outFile needs to be at least TAG_FILE_MAX_SIZE bytes
+// When encoding a raw dump the newly encrypted data is stored to data->raw
+Result EncodeTagFile(NTAGCryptSession* session, NTAGDataT2T* data, bool native, void* outFile, uint32_t* outSize);
+
+// Writes data to path in the native or raw format
+Result WriteTagFile(NTAGCryptSession* session, const char* path, NTAGDataT2T* data, bool native);
+
+// Writes already encoded tag file contents to path
+Result WriteTagFileData(const char* path, const void* file, uint32_t size);
+
+} // namespace re::nfpii
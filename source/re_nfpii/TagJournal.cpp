@@ -0,0 +1,216 @@
+#include "TagJournal.hpp"
+#include "Lock.hpp"
+#include "re_nfpii.hpp"
+#include "utils/FSUtils.hpp"
+#include "utils/LogHandler.hpp"
+#include "utils/stats.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#define TAG_JOURNAL_DIR "/vol/external01/wiiu/re_nfpii_data"
+#define TAG_JOURNAL_PATH TAG_JOURNAL_DIR "/journal.bin"
+
+namespace re::nfpii {
+
+static uint32_t CalculateCRC32(uint32_t crc, const void* data, uint32_t size)
+{
+    const uint8_t* bytes = (const uint8_t*) data;
+
+    crc = ~crc;
+    for (uint32_t i = 0; i < size; i++) {
+        crc ^= bytes[i];
+        for (int j = 0; j < 8; j++) {
+            crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+        }
+    }
+
+    return ~crc;
+}
+
+static uint32_t FindNextRecord(const uint8_t* journal, uint32_t size, uint32_t offset)
+{
+    // A torn append leaves a partial record behind, later appends still follow it
+    for (; offset + sizeof(uint32_t) <= size; offset++) {
+        uint32_t magic;
+        memcpy(&magic, journal + offset, sizeof(magic));
+        if (magic == TAG_JOURNAL_MAGIC) {
+            return offset;
+        }
+    }
+
+    return size;
+}
+
+TagJournal::TagJournal()
+{
+    OSInitMutex(&mutex);
+    sequence = 0;
+    numRecords = 0;
+    replayPending = false;
+    appendFailed = false;
+}
+
+TagJournal::~TagJournal()
+{
+}
+
+Result TagJournal::Replay()
+{
+    Lock lock(&mutex);
+
+    FSUtils::MakeDir(TAG_JOURNAL_DIR);
+
+    FSAStat stat;
+    if (FSUtils::GetStat(TAG_JOURNAL_PATH, &stat) != 0 || stat.size == 0) {
+        // Nothing to replay
+        numRecords = 0;
+        replayPending = false;
+        return NFP_SUCCESS;
+    }
+
+    uint8_t* journal = (uint8_t*) malloc(stat.size);
+    if (!journal) {
+        replayPending = true;
+        return NFP_SYSTEM_ERROR;
+    }
+
+    int size = FSUtils::ReadFromFile(TAG_JOURNAL_PATH, journal, stat.size);
+    if (size < 0) {
+        free(journal);
+        replayPending = true;
+        return NFP_SYSTEM_ERROR;
+    }
+
+    // Records are in the order they were written, so later records replace earlier ones
+    uint32_t offset = 0;
+    uint32_t numReplayed = 0;
+    uint32_t numDamaged = 0;
+    Result res = NFP_SUCCESS;
+    while (offset + sizeof(RecordHeader) <= (uint32_t) size) {
+        RecordHeader header;
+        memcpy(&header, journal + offset, sizeof(header));
+
+        uint32_t recordSize = sizeof(RecordHeader) + header.pathSize + header.dataSize;
+        if (header.magic != TAG_JOURNAL_MAGIC || header.pathSize == 0 || header.pathSize > TAG_JOURNAL_MAX_PATH
+           || header.dataSize > TAG_FILE_MAX_SIZE || offset + recordSize > (uint32_t) size) {
+            numDamaged++;
+            offset = FindNextRecord(journal, size, offset + 1);
+            continue;
+        }
+
+        uint32_t crc = header.crc;
+        header.crc = 0;
+        uint32_t calculated = CalculateCRC32(0, &header, sizeof(header));
+        calculated = CalculateCRC32(calculated, journal + offset + sizeof(RecordHeader), header.pathSize + header.dataSize);
+        if (calculated != crc) {
+            // The write of this record was interrupted, continue with the next one
+            numDamaged++;
+            offset = FindNextRecord(journal, size, offset + 1);
+            continue;
+        }
+
+        std::string path((const char*) journal + offset + sizeof(RecordHeader), header.pathSize);
+        const uint8_t* data = journal + offset + sizeof(RecordHeader) + header.pathSize;
+        auto it = superseded.find(path);
+        if (it != superseded.end() && header.sequence < it->second) {
+            // The file already has newer data
+        } else if (WriteTagFileData(path.c_str(), data, header.dataSize).IsFailure()) {
+            res = NFP_SYSTEM_ERROR;
+        }
+
+        if (header.sequence >= sequence) {
+            sequence = header.sequence + 1;
+        }
+
+        numReplayed++;
+        offset += recordSize;
+    }
+
+    free(journal);
+
+    if (numDamaged > 0) {
+        LogHandler::Warn("Skipped %u damaged records in the tag journal", numDamaged);
+    }
+
+    if (numReplayed > 0) {
+        LogHandler::Info("Replayed %u tag writes from the journal", numReplayed);
+        StatsAdd(NFPII_STAT_JOURNAL_REPLAYED_RECORDS, numReplayed);
+    }
+
+    // The journal is only removed by Reset, if a file couldn't be written it needs to stay around
+    numRecords = numReplayed;
+    replayPending = res.IsFailure();
+    if (res.IsFailure()) {
+        LogHandler::Error("Failed to replay the tag journal");
+    }
+
+    return res;
+}
+
+Result TagJournal::Append(std::string const& path, const void* data, uint32_t size)
+{
+    Lock lock(&mutex);
+
+    if (path.size() == 0 || path.size() > TAG_JOURNAL_MAX_PATH || size > TAG_FILE_MAX_SIZE) {
+        return NFP_INVALID_PARAM;
+    }
+
+    RecordHeader header;
+    header.magic = TAG_JOURNAL_MAGIC;
+    header.sequence = sequence;
+    header.pathSize = path.size();
+    header.dataSize = size;
+    header.crc = 0;
+
+    memcpy(record + sizeof(RecordHeader), path.data(), path.size());
+    memcpy(record + sizeof(RecordHeader) + path.size(), data, size);
+
+    uint32_t crc = CalculateCRC32(0, &header, sizeof(header));
+    header.crc = CalculateCRC32(crc, record + sizeof(RecordHeader), path.size() + size);
+    memcpy(record, &header, sizeof(header));
+
+    uint32_t recordSize = sizeof(RecordHeader) + path.size() + size;
+    int res = FSUtils::AppendToFile(TAG_JOURNAL_PATH, record, recordSize);
+    if (res != (int) recordSize) {
+        LogHandler::Error("Failed to append to the tag journal: %x", res);
+        appendFailed = true;
+        return NFP_SYSTEM_ERROR;
+    }
+
+    sequence++;
+    numRecords++;
+    StatsIncrement(NFPII_STAT_JOURNAL_APPENDS);
+
+    return NFP_SUCCESS;
+}
+
+void TagJournal::Supersede(std::string const& path)
+{
+    Lock lock(&mutex);
+
+    if (numRecords == 0) {
+        return;
+    }
+
+    superseded[path] = sequence;
+}
+
+Result TagJournal::Reset()
+{
+    Lock lock(&mutex);
+
+    int res = FSUtils::Remove(TAG_JOURNAL_PATH);
+    if (res < 0 && res != FS_ERROR_NOT_FOUND) {
+        LogHandler::Error("Failed to remove the tag journal: %x", res);
+        return NFP_SYSTEM_ERROR;
+    }
+
+    numRecords = 0;
+    replayPending = false;
+    appendFailed = false;
+    superseded.clear();
+    return NFP_SUCCESS;
+}
+
+} // namespace re::nfpii
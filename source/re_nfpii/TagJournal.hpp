@@ -0,0 +1,85 @@
+#pragma once
+
+#include "TagFile.hpp"
+
+#include <nn/nfp.h>
+#include <coreinit/mutex.h>
+
+#include <map>
+#include <string>
+
+namespace re::nfpii {
+using nn::Result;
+
+// 'NFJR'
+#define TAG_JOURNAL_MAGIC 0x4e464a52
+
+// Number of records after which the journal should be compacted
+#define TAG_JOURNAL_MAX_RECORDS 16
+
+// Maximum length of a path stored in the journal
+#define TAG_JOURNAL_MAX_PATH 0x100
+
+// Append only journal of tag writes
+// Instead of rewriting the tag files in place, every write is appended to
+// the journal first. The records are folded back into the tag files later,
+// so a power loss while writing never leaves a corrupted tag behind.
+class TagJournal {
+public:
+    TagJournal();
+    virtual ~TagJournal();
+
+    // Writes all complete records back to their files
+    // If a record couldn't be written, the replay needs to be retried before resetting
+    Result Replay();
+
+    Result Append(std::string const& path, const void* data, uint32_t size);
+
+    // Marks the records of path written so far as outdated, after newer data
+    // was written to the file directly, so a replay doesn't restore them
+    void Supersede(std::string const& path);
+
+    // Removes the journal, once all records were folded back into the files
+    Result Reset();
+
+    uint32_t GetNumRecords() const
+    {
+        return numRecords;
+    }
+
+    bool NeedsReplay() const
+    {
+        return replayPending;
+    }
+
+    // Returns false if the journal file needs to be reset, even without any valid records
+    bool IsEmpty() const
+    {
+        return numRecords == 0 && !replayPending && !appendFailed;
+    }
+
+private:
+    struct RecordHeader {
+        uint32_t magic;
+        uint32_t sequence;
+        uint16_t pathSize;
+        uint16_t dataSize;
+        // crc32 over the header (with crc set to 0), path and data
+        uint32_t crc;
+    };
+
+    OSMutex mutex;
+    uint32_t sequence;
+    uint32_t numRecords;
+    // The last replay failed, so the journal has records which aren't in their files
+    bool replayPending;
+    // An append failed and might have left a partial record behind
+    bool appendFailed;
+    // Sequence of the first record which is still valid for a path
+    std::map<std::string, uint32_t> superseded;
+
+    // Buffer for building records, so they can be appended in one go
+    __attribute__((aligned(0x40))) uint8_t record[sizeof(RecordHeader) + TAG_JOURNAL_MAX_PATH + TAG_FILE_MAX_SIZE];
+};
+
+} // namespace re::nfpii
@@ -0,0 +1,283 @@
+#include "TagLoader.hpp"
+#include "TagFile.hpp"
+#include "Lock.hpp"
+#include "re_nfpii.hpp"
+#include "utils/FSUtils.hpp"
+#include "utils/stats.h"
+
+#include <cstring>
+
+namespace re::nfpii {
+
+TagLoader::TagLoader(TagWriter* writer, TagCache* cache, TagPrefetcher* prefetcher, NTAGCryptSession* session)
+ : writer(writer), cache(cache), prefetcher(prefetcher), session(session)
+{
+    OSInitMutex(&mutex);
+    OSInitEvent(&workEvent, FALSE, OS_EVENT_MODE_AUTO);
+
+    callback = nullptr;
+    callbackArg = nullptr;
+
+    running = false;
+    busy.store(false);
+    generation = 0;
+
+    hasRequest = false;
+    hasResult = false;
+    result = NFP_SUCCESS;
+    resultNative = false;
+    memset(&resultData, 0, sizeof(resultData));
+
+    tagInfoBusy.store(false);
+    hasTagInfoRequest = false;
+    hasTagInfoResult = false;
+    tagInfoResult = NFP_SUCCESS;
+    memset(&tagInfoResultData, 0, sizeof(tagInfoResultData));
+}
+
+TagLoader::~TagLoader()
+{
+}
+
+void TagLoader::Start(CompletionFn callback, void* arg)
+{
+    Lock lock(&mutex);
+
+    if (running) {
+        return;
+    }
+
+    this->callback = callback;
+    this->callbackArg = arg;
+
+    running = true;
+    OSCreateThread(&thread, ThreadEntry, 1, (char*) this, stack + sizeof(stack), sizeof(stack), TAG_LOADER_THREAD_PRIORITY, OS_THREAD_ATTRIB_AFFINITY_ANY);
+    OSSetThreadName(&thread, "re_nfpii TagLoader");
+    OSResumeThread(&thread);
+}
+
+void TagLoader::Stop()
+{
+    {
+        Lock lock(&mutex);
+
+        if (!running) {
+            return;
+        }
+
+        running = false;
+        OSSignalEvent(&workEvent);
+    }
+
+    OSJoinThread(&thread, nullptr);
+
+    Clear();
+}
+
+void TagLoader::Request(std::string const& path)
+{
+    Lock lock(&mutex);
+
+    // Already being loaded
+    if (busy.load() && (loadingPath == path || (hasRequest && requestPath == path))) {
+        return;
+    }
+
+    hasRequest = true;
+    requestPath = path;
+    busy.store(true, std::memory_order_release);
+
+    OSSignalEvent(&workEvent);
+}
+
+bool TagLoader::TakeResult(std::string const& path, NTAGDataT2T* outData, bool* outNative, Result* outResult)
+{
+    Lock lock(&mutex);
+
+    if (!hasResult || resultPath != path) {
+        return false;
+    }
+
+    memcpy(outData, &resultData, sizeof(NTAGDataT2T));
+    *outNative = resultNative;
+    *outResult = result;
+    hasResult = false;
+    return true;
+}
+
+bool TagLoader::HasResult(std::string const& path)
+{
+    Lock lock(&mutex);
+
+    return hasResult && resultPath == path;
+}
+
+void TagLoader::RequestTagInfo(std::string const& path)
+{
+    Lock lock(&mutex);
+
+    if (hasTagInfoRequest && tagInfoRequestPath == path) {
+        return;
+    }
+
+    hasTagInfoRequest = true;
+    tagInfoRequestPath = path;
+    tagInfoBusy.store(true, std::memory_order_release);
+
+    OSSignalEvent(&workEvent);
+}
+
+bool TagLoader::TakeTagInfo(std::string const& path, NFCTagInfo* outInfo, Result* outResult)
+{
+    Lock lock(&mutex);
+
+    if (!hasTagInfoResult || tagInfoResultPath != path) {
+        return false;
+    }
+
+    memcpy(outInfo, &tagInfoResultData, sizeof(NFCTagInfo));
+    *outResult = tagInfoResult;
+    hasTagInfoResult = false;
+    return true;
+}
+
+void TagLoader::Clear()
+{
+    Lock lock(&mutex);
+
+    generation++;
+    hasRequest = false;
+    hasResult = false;
+    loadingPath.clear();
+    busy.store(false, std::memory_order_release);
+
+    hasTagInfoRequest = false;
+    hasTagInfoResult = false;
+    tagInfoBusy.store(false, std::memory_order_release);
+}
+
+Result TagLoader::Load(std::string const& path, NTAGDataT2T* outData, bool* outNative)
+{
+    // Tags which weren't written to the SD yet are taken from the writer
+    if (writer->Get(path, outData, outNative)) {
+        return NFP_SUCCESS;
+    }
+
+    // Check if we already have the decrypted data for this file cached
+    FSAStat stat;
+    bool hasStat = FSUtils::GetStat(path.c_str(), &stat) == 0;
+    if (hasStat && (cache->Get(path, stat, outData, outNative) ||
+        prefetcher->Get(path, stat, outData, outNative))) {
+        return NFP_SUCCESS;
+    }
+
+    // Read and decrypt the tag
+    Result res = ReadTagFile(session, path.c_str(), outData, outNative);
+    if (res.IsFailure()) {
+        return res;
+    }
+
+    if (hasStat) {
+        cache->Put(path, stat, outData, *outNative);
+    }
+
+    return NFP_SUCCESS;
+}
+
+void TagLoader::Run()
+{
+    Lock lock(&mutex);
+
+    while (running) {
+        if (!hasRequest && !hasTagInfoRequest) {
+            // Nothing to do, so wait for a new request
+            OSUnlockMutex(&mutex);
+            OSWaitEvent(&workEvent);
+            OSLockMutex(&mutex);
+            continue;
+        }
+
+        // Reading the tag info is cheap and a game might be polling for it, so do it first
+        if (hasTagInfoRequest) {
+            std::string path = tagInfoRequestPath;
+            uint32_t gen = generation;
+            hasTagInfoRequest = false;
+
+            OSUnlockMutex(&mutex);
+
+            NFCTagInfo info{};
+            Result res = ReadTagFileInfo(path.c_str(), &info);
+
+            OSLockMutex(&mutex);
+
+            // Cleared while reading
+            if (gen != generation) {
+                continue;
+            }
+
+            hasTagInfoResult = true;
+            tagInfoResultPath = path;
+            tagInfoResult = res;
+            memcpy(&tagInfoResultData, &info, sizeof(NFCTagInfo));
+
+            if (!hasTagInfoRequest) {
+                tagInfoBusy.store(false, std::memory_order_release);
+            }
+
+            if (callback) {
+                OSUnlockMutex(&mutex);
+                callback(callbackArg);
+                OSLockMutex(&mutex);
+            }
+            continue;
+        }
+
+        std::string path = requestPath;
+        uint32_t gen = generation;
+        hasRequest = false;
+        loadingPath = path;
+
+        OSUnlockMutex(&mutex);
+
+        NTAGDataT2T data;
+        bool native = false;
+        Result res = Load(path, &data, &native);
+
+        StatsIncrement(NFPII_STAT_TAG_LOADER_LOADS);
+
+        OSLockMutex(&mutex);
+
+        loadingPath.clear();
+
+        // Cleared while loading
+        if (gen != generation) {
+            continue;
+        }
+
+        hasResult = true;
+        resultPath = path;
+        result = res;
+        resultNative = native;
+        memcpy(&resultData, &data, sizeof(NTAGDataT2T));
+
+        if (!hasRequest) {
+            busy.store(false, std::memory_order_release);
+        }
+
+        // Let the manager pick up the result
+        if (callback) {
+            OSUnlockMutex(&mutex);
+            callback(callbackArg);
+            OSLockMutex(&mutex);
+        }
+    }
+}
+
+int TagLoader::ThreadEntry(int argc, const char** argv)
+{
+    TagLoader* loader = (TagLoader*) argv;
+    loader->Run();
+    return 0;
+}
+
+} // namespace re::nfpii
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "TagCache.hpp"
+#include "TagWriter.hpp"
+#include "TagPrefetcher.hpp"
+#include "ntag_crypt.h"
+
+#include <nn/nfp.h>
+#include <ntag/ntag.h>
+#include <nfc/nfc.h>
+#include <coreinit/mutex.h>
+#include <coreinit/event.h>
+#include <coreinit/thread.h>
+
+#include <atomic>
+#include <string>
+
+namespace re::nfpii {
+using nn::Result;
+
+// Stack size of the loader thread
+#define TAG_LOADER_STACK_SIZE 0x4000
+
+// Priority of the loader thread, below the game but above the prefetcher
+#define TAG_LOADER_THREAD_PRIORITY 20
+
+// Reads and decrypts the tag which should be presented next, so the
+// proc alarm never has to wait for the SD or IOSU
+// Only the latest request is kept, and only the latest result.
+// The NFC tag info used for NFCGetTagInfo is read the same way, next to the tag loads.
+class TagLoader {
+public:
+    typedef void (*CompletionFn)(void* arg);
+
+    TagLoader(TagWriter* writer, TagCache* cache, TagPrefetcher* prefetcher, NTAGCryptSession* session);
+    virtual ~TagLoader();
+
+    // callback is called from the loader thread once a load finished
+    void Start(CompletionFn callback, void* arg);
+    void Stop();
+
+    void Request(std::string const& path);
+
+    // Takes the result for path, if the loader finished loading it
+    bool TakeResult(std::string const& path, NTAGDataT2T* outData, bool* outNative, Result* outResult);
+    bool HasResult(std::string const& path);
+
+    // Only reads the NFC tag info of path, without decrypting the tag
+    void RequestTagInfo(std::string const& path);
+    bool TakeTagInfo(std::string const& path, NFCTagInfo* outInfo, Result* outResult);
+
+    // Drops the current results and any load in progress
+    void Clear();
+
+    // Can be read without any locks held
+    bool IsBusy() const
+    {
+        return busy.load(std::memory_order_acquire);
+    }
+
+    bool IsTagInfoBusy() const
+    {
+        return tagInfoBusy.load(std::memory_order_acquire);
+    }
+
+    // Loads a tag directly on the calling thread
+    Result Load(std::string const& path, NTAGDataT2T* outData, bool* outNative);
+
+private:
+    void Run();
+    static int ThreadEntry(int argc, const char** argv);
+
+    TagWriter* writer;
+    TagCache* cache;
+    TagPrefetcher* prefetcher;
+    NTAGCryptSession* session;
+
+    CompletionFn callback;
+    void* callbackArg;
+
+    OSMutex mutex;
+    OSEvent workEvent;
+
+    bool running;
+    // A request or a load is outstanding
+    std::atomic<bool> busy;
+    // Incremented by Clear, so loads which were in progress are dropped
+    uint32_t generation;
+
+    bool hasRequest;
+    std::string requestPath;
+    std::string loadingPath;
+
+    bool hasResult;
+    std::string resultPath;
+    Result result;
+    bool resultNative;
+    NTAGDataT2T resultData;
+
+    // A tag info request or read is outstanding
+    std::atomic<bool> tagInfoBusy;
+    bool hasTagInfoRequest;
+    std::string tagInfoRequestPath;
+
+    bool hasTagInfoResult;
+    std::string tagInfoResultPath;
+    Result tagInfoResult;
+    NFCTagInfo tagInfoResultData;
+
+    OSThread thread;
+    __attribute__((aligned(8))) uint8_t stack[TAG_LOADER_STACK_SIZE];
+};
+
+} // namespace re::nfpii
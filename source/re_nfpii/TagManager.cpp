@@ -1,56 +1,145 @@
 #include "TagManager.hpp"
 #include "Utils.hpp"
+#include "TagFile.hpp"
 #include "re_nfpii.hpp"
 #include "Lock.hpp"
 #include "ntag_crypt.h"
 #include "debug/logger.h"
 #include "utils/FSUtils.hpp"
 #include "utils/LogHandler.hpp"
+#include "utils/stats.h"
 
+#include <algorithm>
 #include <cstring>
+#include <coreinit/atomic64.h>
+#include <coreinit/title.h>
+
+// How long to wait before retrying the proc if the mutex is busy
+// Releasing the mutex wakes the proc, so the retry doubles up to the max while the mutex stays busy
+#define NFC_PROC_RETRY_MIN_MS 1
+#define NFC_PROC_RETRY_MAX_MS 16
+
+// Error passed to NFCGetTagInfo callbacks if no tag was found
+#define NFC_TAG_INFO_ERROR -0x1383
+
+// Keys used for the software crypto backend
+#define AMIIBO_KEYS_PATH "/vol/external01/wiiu/re_nfpii_data/key_retail.bin"
 
 namespace re::nfpii {
 
+// Lock guard for the manager mutex, which counts the acquisitions
+// Public calls should only lock once and use the *Locked variants from there on
+// After the outermost lock was released, the proc alarm is woken up if it was deferred
+// The proc itself never runs on the releasing thread, since it calls the application's callbacks
+class ManagerLock {
+public:
+    ManagerLock(TagManager* mgr)
+     : mgr(mgr)
+    {
+        StatsIncrement(NFPII_STAT_MANAGER_LOCKS);
+        if (mgr->mutex.owner == OSGetCurrentThread()) {
+            StatsIncrement(NFPII_STAT_MANAGER_RECURSIVE_LOCKS);
+        }
+
+        OSLockMutex(&mgr->mutex);
+    }
+
+    ~ManagerLock()
+    {
+        bool outermost = mgr->mutex.count == 1;
+
+        OSUnlockMutex(&mgr->mutex);
+
+        if (outermost && mgr->HasDeferredProc()) {
+            mgr->WakeProc();
+        }
+    }
+
+private:
+    TagManager* mgr;
+};
+
 TagManager::TagManager()
+ : tagWriter(&tagCache, &cryptSession), tagPrefetcher(&cryptSession),
+   tagLoader(&tagWriter, &tagCache, &tagPrefetcher, &cryptSession)
 {
     activateEvent = nullptr;
     nfpState = NfpState::Uninitialized;
+    publishedNfpState.store(NfpState::Uninitialized);
     deactivateEvent = nullptr;
     memset(tagStates, 0, sizeof(tagStates));
     readOnly = false;
 
     OSInitMutex(&mutex);
     OSCreateAlarmEx(&nfcProcAlarm, "NfcProcAlarm");
-
+    OSInitSpinLock(&nfcProcAlarmLock);
+
+    appliedConfigSequence = 0;
+    appliedEmulationStateChanges = 0;
+    deferredProcTime = 0;
+    procRetryMs = NFC_PROC_RETRY_MIN_MS;
+    procAlarmTime = 0;
+    clock = &systemClock;
+    stateTraceCount = 0;
     emulationState = NFPII_EMULATION_OFF;
     uuidRandomizationState = NFPII_RANDOMIZATION_OFF;
     tagEmulationPath = "";
     removeAfterSeconds = 0.0f;
     pendingRemove = false;
+    pendingTagSwitch = false;
     pendingTagRemoveTime = 0;
 
-    pendingTagInfo = false;
-    nfcTagInfoCallback = nullptr;
-    nfcTagInfoArg = nullptr;
+    numTagInfoRequests = 0;
+    newTagInfoRequest = false;
+    nextTagInfoTime = 0;
+
+    hasNfcTagInfo = false;
+    memset(&nfcTagInfo, 0, sizeof(nfcTagInfo));
 
     inAmiiboSettings = false;
+    activationProfile = NFPII_ACTIVATION_PROFILE_INSTANT;
+    activateTime = 0;
     amiiboSettingsReattachTimeout = 0;
+    amiiboSettingsReattachPending = false;
+
+    tagSlotUseCounter = 0;
+    memset(tagSlotLastUse, 0, sizeof(tagSlotLastUse));
+
+    preloading = false;
+    firstDetectionStart = 0;
+    firstDetectionDone = false;
+    firstDetectionPreloaded = false;
+
+    NTAGInitCryptSession(&cryptSession);
 }
 
 TagManager::~TagManager()
 {
 }
 
+static void LoadAmiiboKeys()
+{
+    // Load the amiibo keys for the software crypto backend, if the user provided them
+    if (!NTAGHasAmiiboKeys()) {
+        __attribute__((aligned(0x40))) uint8_t keys[0xa0];
+        if (FSUtils::ReadFromFile(AMIIBO_KEYS_PATH, keys, sizeof(keys)) == sizeof(keys)) {
+            if (NTAGLoadAmiiboKeys(keys, sizeof(keys)) != 0) {
+                LogHandler::Warn("Invalid amiibo keys in %s", AMIIBO_KEYS_PATH);
+            }
+        }
+    }
+}
+
 bool TagManager::IsInitialized()
 {
-    return nfpState != NfpState::Uninitialized;
+    return GetPublishedNfpState() != NfpState::Uninitialized;
 }
 
 Result TagManager::Initialize()
 {
-    Lock lock(&mutex);
+    ManagerLock lock(this);
 
-    if (nfpState != NfpState::Uninitialized) {
+    if (!IsStateAllowed(NfpOperation::Initialize)) {
         return NFP_INVALID_STATE;
     }
 
@@ -60,32 +149,65 @@ Result TagManager::Initialize()
     // Reset the internal state
     Reset();
 
-    // TODO ACPInitialize
+    ApplyConfig();
 
-    // Setup the proc alarm
-    OSSetAlarmUserData(&nfcProcAlarm, this);
-    OSSetPeriodicAlarm(&nfcProcAlarm, OSGetTime(), OSMillisecondsToTicks(15), NfcProcCallback);
+    // TODO ACPInitialize
 
     // Initialize our custom FS utils here, since every game will have
     // to call this, even after returning from amiibo settings
     FSUtils::Initialize();
 
+    LoadAmiiboKeys();
+
+    // Keep /dev/ccr_nfc open while nfp is initialized
+    // If this fails, the session will be reopened on the next operation
+    if (NTAGOpenCryptSession(&cryptSession) != 0) {
+        LogHandler::Warn("Failed to open /dev/ccr_nfc");
+    }
+
+    // Finish writes which didn't make it from the journal to the tag files
+    if (tagWriter.Recover().IsFailure()) {
+        LogHandler::Warn("Failed to recover tag writes from the journal");
+    }
+
+    // Start the thread writing the tags to the SD
+    tagWriter.Start();
+
+    // Start decrypting the favorites in the background
+    tagPrefetcher.Start();
+
+    // Tags are loaded on their own thread, so the proc never waits for the SD
+    // If the tag was preloaded, this keeps the loader and its result around
+    tagLoader.Start(TagLoadedCallback, this);
+    preloading = false;
+
     SetNfpState(NfpState::Initialized);
 
+    // Setup the proc alarm, there might already be a queued tag info request
+    ScheduleProc();
+
     return NFP_SUCCESS;
 }
 
 Result TagManager::Finalize()
 {
-    Lock lock(&mutex);
+    ManagerLock lock(this);
 
     if (!UpdateInternal()) {
         return NFP_INVALID_STATE;
     }
 
-    StopDetection();
+    StopDetectionLocked();
     OSCancelAlarm(&nfcProcAlarm);
 
+    tagLoader.Stop();
+    tagPrefetcher.Stop();
+
+    // Make sure all tags are written, before the SD is unmounted
+    tagWriter.Stop();
+
+    NTAGCloseCryptSession(&cryptSession);
+
     FSUtils::Finalize();
 
     Reset();
@@ -110,7 +232,7 @@ Result TagManager::SetActivateEvent(OSEvent* event)
         return NFP_INVALID_PARAM;
     }
 
-    if (nfpState != NfpState::Initialized) {
+    if (!IsStateAllowed(NfpOperation::SetEvent)) {
         return NFP_INVALID_STATE;
     }
 
@@ -126,7 +248,7 @@ Result TagManager::SetDeactivateEvent(OSEvent* event)
         return NFP_INVALID_PARAM;
     }
 
-    if (nfpState != NfpState::Initialized) {
+    if (!IsStateAllowed(NfpOperation::SetEvent)) {
         return NFP_INVALID_STATE;
     }
 
@@ -138,13 +260,13 @@ Result TagManager::SetDeactivateEvent(OSEvent* event)
 
 Result TagManager::StartDetection()
 {
-    Lock lock(&mutex);
+    ManagerLock lock(this);
 
     if (!UpdateInternal()) {
         return NFP_INVALID_STATE;
     }
 
-    if (nfpState != NfpState::Initialized && nfpState != NfpState::Removed) {
+    if (!IsStateAllowed(NfpOperation::StartDetection)) {
         return NFP_INVALID_STATE;
     }
 
@@ -158,15 +280,31 @@ Result TagManager::StartDetection()
 
     SetNfpState(NfpState::Searching);
 
+    if (!firstDetectionDone && firstDetectionStart == 0) {
+        firstDetectionStart = OSGetSystemTime();
+    }
+
+    ApplyConfig();
+
+    // Some titles need the tag to be found with a delay
+    activationProfile = activationProfiles.Get(OSGetTitleID());
+    activateTime = clock->GetTime() + OSMillisecondsToTicks(ActivationProfiles::GetTiming(activationProfile).activationDelayMs);
+
     // Since we can't open the configuration while in an applet
     // we re-attach the tag once detection starts
-    if (inAmiiboSettings && OSGetTime() > amiiboSettingsReattachTimeout) {
+    if (inAmiiboSettings && clock->GetTime() > amiiboSettingsReattachTimeout) {
         emulationState = NFPII_EMULATION_ON;
+        amiiboSettingsReattachPending = false;
     }
 
-    // If emulation isn't turned off load the tag
-    if (emulationState != NFPII_EMULATION_OFF) {
-        Result res = LoadTag();
+    if (emulationState != NFPII_EMULATION_OFF && clock->GetTime() < activateTime) {
+        // The proc finds the tag once the delay passed, until then the loader can already read it
+        if (!CanLoadTagNow()) {
+            tagLoader.Request(tagEmulationPath);
+        }
+    } else if (emulationState != NFPII_EMULATION_OFF) {
+        // If emulation isn't turned off load the tag
+        Result res = LoadTag(true);
         DEBUG_FUNCTION_LINE("LoadTag: %x", ((NNResult) res).value);
 
         // We still "succeed" on failure but turn off emulation
@@ -176,26 +314,33 @@ Result TagManager::StartDetection()
         }
     }
 
+    ScheduleProc();
+
     return NFP_SUCCESS;
 }
 
 Result TagManager::StopDetection()
 {
-    Lock lock(&mutex);
+    ManagerLock lock(this);
+
+    return StopDetectionLocked();
+}
+
+Result TagManager::StopDetectionLocked()
+{
+    AssertLocked();
 
     if (!UpdateInternal()) {
         return NFP_INVALID_STATE;
     }
 
-    if (nfpState != NfpState::Searching && nfpState != NfpState::Found &&
-        nfpState != NfpState::Mounted && nfpState != NfpState::MountedROM &&
-        nfpState != NfpState::Removed) {
+    if (!IsStateAllowed(NfpOperation::StopDetection)) {
         return NFP_INVALID_STATE;
     }
 
     // Unmount the tag if it's currently mounted
-    if (nfpState == NfpState::Mounted || nfpState == NfpState::MountedROM) {
-        Unmount();
+    if (IsStateAllowed(NfpOperation::Unmount)) {
+        UnmountLocked();
     }
 
     // Deactivate the tag if we have one
@@ -203,9 +348,12 @@ Result TagManager::StopDetection()
         Deactivate();
     }
 
+    // Results of the loader might be outdated once the tag was used
+    tagLoader.Clear();
+
     // Clear the current tag if we have one
+    // The tag data stays resident in its slot, so it can be presented again without reloading it
     if (currentTag) {
-        currentTag->ClearTagData();
         currentTag = nullptr;
     }
 
@@ -213,17 +361,20 @@ Result TagManager::StopDetection()
 
     // Set re-attach timeout to allow getting out of menus while in amiibo settings
     if (inAmiiboSettings) {
-        amiiboSettingsReattachTimeout = OSGetTime() + OSMillisecondsToTicks(2000);
+        amiiboSettingsReattachTimeout = clock->GetTime() + OSMillisecondsToTicks(ActivationProfiles::GetTiming(activationProfile).stopReattachMs);
+        amiiboSettingsReattachPending = true;
         emulationState = NFPII_EMULATION_OFF;
     }
 
+    ScheduleProc();
+
     return NFP_SUCCESS;
 }
 
 
 Result TagManager::Mount()
 {
-    Lock lock(&mutex);
+    ManagerLock lock(this);
 
     if (!UpdateInternal()) {
         return NFP_INVALID_STATE;
@@ -233,7 +384,7 @@ Result TagManager::Mount()
         return NFP_OUT_OF_RANGE;
     }
 
-    if (nfpState != NfpState::Found) {
+    if (!IsStateAllowed(NfpOperation::Mount)) {
         return NFP_INVALID_STATE;
     }
 
@@ -250,7 +401,7 @@ Result TagManager::Mount()
 
 Result TagManager::MountReadOnly()
 {
-    Lock lock(&mutex);
+    ManagerLock lock(this);
 
     if (!UpdateInternal()) {
         return NFP_INVALID_STATE;
@@ -260,7 +411,7 @@ Result TagManager::MountReadOnly()
         return NFP_OUT_OF_RANGE;
     }
 
-    if (nfpState != NfpState::Found) {
+    if (!IsStateAllowed(NfpOperation::Mount)) {
         return NFP_INVALID_STATE;
     }
 
@@ -282,7 +433,7 @@ Result TagManager::MountReadOnly()
 
 Result TagManager::MountRom()
 {
-    Lock lock(&mutex);
+    ManagerLock lock(this);
 
     if (!UpdateInternal()) {
         return NFP_INVALID_STATE;
@@ -292,7 +443,7 @@ Result TagManager::MountRom()
         return NFP_OUT_OF_RANGE;
     }
 
-    if (nfpState != NfpState::Found) {
+    if (!IsStateAllowed(NfpOperation::Mount)) {
         return NFP_INVALID_STATE;
     }
 
@@ -310,13 +461,32 @@ Result TagManager::MountRom()
 
 Result TagManager::Unmount()
 {
-    Lock lock(&mutex);
+    ManagerLock lock(this);
+
+    Result res = UnmountLocked();
+    if (res.IsFailure()) {
+        return res;
+    }
+
+    // Wait for the tag to be written to the journal, so the game sees if saving failed
+    // The proc and StopDetection don't wait for the SD, the next Flush or Unmount reports their failures
+    res = tagWriter.Drain();
+    if (res.IsFailure()) {
+        LogHandler::Error("Failed to write tag to the SD");
+    }
+
+    return res;
+}
+
+Result TagManager::UnmountLocked()
+{
+    AssertLocked();
 
     if (!UpdateInternal()) {
         return NFP_INVALID_STATE;
     }
 
-    if (nfpState != NfpState::Mounted && nfpState != NfpState::MountedROM) {
+    if (!IsStateAllowed(NfpOperation::Unmount)) {
         return NFP_INVALID_STATE;
     }
 
@@ -324,7 +494,7 @@ Result TagManager::Unmount()
         tagStream.Close();
     }
 
-    Result res = tag.Unmount();
+    Result res = tags[currentTagIndex].Unmount();
     if (res.IsSuccess()) {
         SetNfpState(NfpState::Found);
         readOnly = false;
@@ -336,22 +506,25 @@ Result TagManager::Unmount()
         if (deactivateEvent) {
             OSSignalEvent(deactivateEvent);
         }
-        amiiboSettingsReattachTimeout = OSGetTime() + OSMillisecondsToTicks(1500);
+        amiiboSettingsReattachTimeout = clock->GetTime() + OSMillisecondsToTicks(ActivationProfiles::GetTiming(activationProfile).unmountReattachMs);
+        amiiboSettingsReattachPending = true;
         emulationState = NFPII_EMULATION_OFF;
     }
 
+    ScheduleProc();
+
     return res;
 }
 
 Result TagManager::Flush()
 {
-    Lock lock(&mutex);
+    ManagerLock lock(this);
 
     if (!UpdateInternal()) {
         return NFP_INVALID_STATE;
     }
 
-    if (nfpState != NfpState::Mounted) {
+    if (!IsStateAllowed(NfpOperation::AccessMounted)) {
         return NFP_INVALID_STATE;
     }
 
@@ -364,7 +537,7 @@ Result TagManager::Flush()
     }
 
     TagInfo info;
-    Result res = GetTagInfo(&info, currentTagIndex);
+    Result res = GetTagInfoLocked(&info, currentTagIndex);
     if (res.IsFailure()) {
         return res;
     }
@@ -374,18 +547,24 @@ Result TagManager::Flush()
         return res;   
     }
 
-    return NFP_SUCCESS;
+    // The write itself happens in the background, but report earlier writes which didn't make it to the SD
+    res = tagWriter.TakeLastResult();
+    if (res.IsFailure()) {
+        LogHandler::Error("Failed to write tag to the SD");
+    }
+
+    return res;
 }
 
 Result TagManager::Restore()
 {
-    Lock lock(&mutex);
+    ManagerLock lock(this);
 
     if (!UpdateInternal()) {
         return NFP_INVALID_STATE;
     }
 
-    if (nfpState != NfpState::Found) {
+    if (!IsStateAllowed(NfpOperation::Restore)) {
         return NFP_INVALID_STATE;
     }
 
@@ -400,13 +579,13 @@ Result TagManager::Format(const void* data, int32_t size)
         return NFP_INVALID_PARAM;
     }
 
-    Lock lock(&mutex);
+    ManagerLock lock(this);
 
     if (!UpdateInternal()) {
         return NFP_INVALID_STATE;
     }
 
-    if (nfpState != NfpState::Found) {
+    if (!IsStateAllowed(NfpOperation::Format)) {
         return NFP_INVALID_STATE;
     }
 
@@ -416,7 +595,7 @@ Result TagManager::Format(const void* data, int32_t size)
     }
 
     NTAGDataT2T* ntagData = tagStates[currentTagIndex].tag->GetData();
-    res = tag.Format(ntagData, data, size);
+    res = tags[currentTagIndex].Format(ntagData, data, size);
     if (res.IsFailure()) {
         return res;
     }
@@ -428,8 +607,8 @@ Result TagManager::Format(const void* data, int32_t size)
 
 bool TagManager::IsExistApplicationArea()
 {
-    if (UpdateInternal() && nfpState == NfpState::Mounted) {
-        return tag.IsExistApplicationArea();
+    if (UpdateInternal() && IsStateAllowed(NfpOperation::AccessMounted)) {
+        return tags[currentTagIndex].IsExistApplicationArea();
     }
 
     return false;
@@ -437,13 +616,13 @@ bool TagManager::IsExistApplicationArea()
 
 Result TagManager::CreateApplicationArea(ApplicationAreaCreateInfo const& createInfo)
 {
-    Lock lock(&mutex);
+    ManagerLock lock(this);
 
     if (!UpdateInternal()) {
         return NFP_INVALID_STATE;
     }
 
-    if (nfpState != NfpState::Mounted) {
+    if (!IsStateAllowed(NfpOperation::AccessMounted)) {
         return NFP_INVALID_STATE;
     }
 
@@ -460,7 +639,7 @@ Result TagManager::CreateApplicationArea(ApplicationAreaCreateInfo const& create
         return NFP_APP_AREA_ALREADY_EXISTS;
     }
 
-    return tag.CreateApplicationArea(tag.GetData(), createInfo);
+    return tags[currentTagIndex].CreateApplicationArea(tags[currentTagIndex].GetData(), createInfo);
 }
 
 Result TagManager::WriteApplicationArea(const void* data, uint32_t size, const TagId* tagId)
@@ -473,7 +652,7 @@ Result TagManager::WriteApplicationArea(const void* data, uint32_t size, const T
         return NFP_INVALID_PARAM;
     }
 
-    if (nfpState != NfpState::Mounted || readOnly) {
+    if (!IsStateAllowed(NfpOperation::AccessMounted) || readOnly) {
         return NFP_INVALID_STATE;
     }
 
@@ -491,7 +670,7 @@ Result TagManager::OpenApplicationArea(uint32_t id)
         return NFP_INVALID_STATE;
     }
 
-    if (nfpState != NfpState::Mounted) {
+    if (!IsStateAllowed(NfpOperation::AccessMounted)) {
         return NFP_INVALID_STATE;
     }
 
@@ -531,7 +710,7 @@ Result TagManager::ReadApplicationArea(void* outData, uint32_t size)
         return NFP_INVALID_PARAM;
     }
 
-    if (nfpState != NfpState::Mounted) {
+    if (!IsStateAllowed(NfpOperation::AccessMounted)) {
         return NFP_INVALID_STATE;
     }
 
@@ -540,13 +719,13 @@ Result TagManager::ReadApplicationArea(void* outData, uint32_t size)
 
 Result TagManager::DeleteApplicationArea()
 {
-    Lock lock(&mutex);
+    ManagerLock lock(this);
 
     if (!UpdateInternal()) {
         return NFP_INVALID_STATE;
     }
 
-    if (nfpState != NfpState::Mounted) {
+    if (!IsStateAllowed(NfpOperation::AccessMounted)) {
         return NFP_INVALID_STATE;
     }
 
@@ -563,7 +742,7 @@ Result TagManager::DeleteApplicationArea()
         return NFP_APP_AREA_MISING;
     }
 
-    return tag.DeleteApplicationArea();
+    return tags[currentTagIndex].DeleteApplicationArea();
 }
 
 Result TagManager::GetTagInfo(TagInfo* outTagInfo)
@@ -578,13 +757,20 @@ Result TagManager::GetNfpCommonInfo(CommonInfo* outCommonInfo)
         return NFP_INVALID_PARAM;
     }
 
-    Lock lock(&mutex);
+    ManagerLock lock(this);
+
+    return GetNfpCommonInfoLocked(outCommonInfo);
+}
+
+Result TagManager::GetNfpCommonInfoLocked(CommonInfo* outCommonInfo)
+{
+    AssertLocked();
 
     if (!UpdateInternal()) {
         return NFP_INVALID_STATE;
     }
 
-    if (nfpState != NfpState::Mounted) {
+    if (!IsStateAllowed(NfpOperation::AccessMounted)) {
         return NFP_INVALID_STATE;
     }   
 
@@ -594,8 +780,7 @@ Result TagManager::GetNfpCommonInfo(CommonInfo* outCommonInfo)
 
     // TODO tag state stuff
 
-    NTAGDataT2T* data = tagStates[currentTagIndex].tag->GetData();
-    ReadCommonInfo(outCommonInfo, data);
+    tagStates[currentTagIndex].tag->GetCommonInfo(outCommonInfo);
 
     return NFP_SUCCESS;
 }
@@ -606,13 +791,20 @@ Result TagManager::GetNfpRegisterInfo(RegisterInfo* outRegisterInfo)
         return NFP_INVALID_PARAM;
     }
 
-    Lock lock(&mutex);
+    ManagerLock lock(this);
+
+    return GetNfpRegisterInfoLocked(outRegisterInfo);
+}
+
+Result TagManager::GetNfpRegisterInfoLocked(RegisterInfo* outRegisterInfo)
+{
+    AssertLocked();
 
     if (!UpdateInternal()) {
         return NFP_INVALID_STATE;
     }
 
-    if (nfpState != NfpState::Mounted) {
+    if (!IsStateAllowed(NfpOperation::AccessMounted)) {
         return NFP_INVALID_STATE;
     }
 
@@ -626,21 +818,20 @@ Result TagManager::GetNfpRegisterInfo(RegisterInfo* outRegisterInfo)
         return NFP_NO_REGISTER_INFO;
     }
 
-    NTAGDataT2T* data = tagStates[currentTagIndex].tag->GetData();
-    ReadRegisterInfo(outRegisterInfo, data);
+    tagStates[currentTagIndex].tag->GetRegisterInfo(outRegisterInfo);
 
     return NFP_SUCCESS;
 }
 
 Result TagManager::DeleteNfpRegisterInfo()
 {
-    Lock lock(&mutex);
+    ManagerLock lock(this);
 
     if (!UpdateInternal()) {
         return NFP_INVALID_STATE;
     }
 
-    if (nfpState != NfpState::Mounted) {
+    if (!IsStateAllowed(NfpOperation::AccessMounted)) {
         return NFP_INVALID_STATE;
     }
 
@@ -657,7 +848,7 @@ Result TagManager::DeleteNfpRegisterInfo()
         return NFP_NO_REGISTER_INFO;
     }
 
-    return tag.DeleteRegisterInfo();
+    return tags[currentTagIndex].DeleteRegisterInfo();
 }
 
 Result TagManager::GetNfpReadOnlyInfo(ReadOnlyInfo* outReadOnlyInfo)
@@ -666,13 +857,20 @@ Result TagManager::GetNfpReadOnlyInfo(ReadOnlyInfo* outReadOnlyInfo)
         return NFP_INVALID_PARAM;
     }
 
-    Lock lock(&mutex);
+    ManagerLock lock(this);
+
+    return GetNfpReadOnlyInfoLocked(outReadOnlyInfo);
+}
+
+Result TagManager::GetNfpReadOnlyInfoLocked(ReadOnlyInfo* outReadOnlyInfo)
+{
+    AssertLocked();
 
     if (!UpdateInternal()) {
         return NFP_INVALID_STATE;
     }
 
-    if (nfpState != NfpState::Found && nfpState != NfpState::Mounted) {
+    if (!IsStateAllowed(NfpOperation::GetReadOnlyInfo)) {
         return NFP_INVALID_STATE;
     }
 
@@ -682,8 +880,7 @@ Result TagManager::GetNfpReadOnlyInfo(ReadOnlyInfo* outReadOnlyInfo)
 
     // TODO tag state stuff
 
-    NTAGDataT2T* data = tagStates[currentTagIndex].tag->GetData();
-    ReadReadOnlyInfo(outReadOnlyInfo, data);
+    tagStates[currentTagIndex].tag->GetReadOnlyInfo(outReadOnlyInfo);
 
     return NFP_SUCCESS;
 }
@@ -694,13 +891,13 @@ Result TagManager::GetNfpRomInfo(RomInfo* outRomInfo)
         return NFP_INVALID_PARAM;
     }
 
-    Lock lock(&mutex);
+    ManagerLock lock(this);
 
     if (!UpdateInternal()) {
         return NFP_INVALID_STATE;
     }
 
-    if (nfpState != NfpState::Mounted && nfpState != NfpState::MountedROM) {
+    if (!IsStateAllowed(NfpOperation::GetRomInfo)) {
         return NFP_INVALID_STATE;
     }
 
@@ -710,8 +907,7 @@ Result TagManager::GetNfpRomInfo(RomInfo* outRomInfo)
 
     // TODO tag state stuff
 
-    NTAGDataT2T* data = tagStates[currentTagIndex].tag->GetData();
-    ReadReadOnlyInfo(outRomInfo, data);
+    tagStates[currentTagIndex].tag->GetReadOnlyInfo(outRomInfo);
 
     return NFP_SUCCESS;
 }
@@ -722,13 +918,20 @@ Result TagManager::GetNfpAdminInfo(AdminInfo* outAdminInfo)
         return NFP_INVALID_PARAM;
     }
 
-    Lock lock(&mutex);
+    ManagerLock lock(this);
+
+    return GetNfpAdminInfoLocked(outAdminInfo);
+}
+
+Result TagManager::GetNfpAdminInfoLocked(AdminInfo* outAdminInfo)
+{
+    AssertLocked();
 
     if (!UpdateInternal()) {
         return NFP_INVALID_STATE;
     }
 
-    if (nfpState != NfpState::Mounted) {
+    if (!IsStateAllowed(NfpOperation::AccessMounted)) {
         return NFP_INVALID_STATE;
     }
 
@@ -738,21 +941,58 @@ Result TagManager::GetNfpAdminInfo(AdminInfo* outAdminInfo)
 
     // TODO tag state stuff
 
-    NTAGDataT2T* data = tagStates[currentTagIndex].tag->GetData();
-    ReadAdminInfo(outAdminInfo, data);
+    tagStates[currentTagIndex].tag->GetAdminInfo(outAdminInfo);
+
+    return NFP_SUCCESS;
+}
+
+Result TagManager::GetAllTagInfo(NfpiiAllTagInfo* outInfo, uint32_t* outFlags)
+{
+    if (!outInfo || !outFlags) {
+        return NFP_INVALID_PARAM;
+    }
+
+    *outFlags = 0;
+
+    ManagerLock lock(this);
+
+    if (!UpdateInternal()) {
+        return NFP_INVALID_STATE;
+    }
+
+    // Which of these are available depends on the state, so just fill what we can
+    if (GetTagInfoLocked(&outInfo->tagInfo, currentTagIndex).IsSuccess()) {
+        *outFlags |= NFPII_TAG_INFO_TAG;
+    }
+
+    if (GetNfpCommonInfoLocked(&outInfo->commonInfo).IsSuccess()) {
+        *outFlags |= NFPII_TAG_INFO_COMMON;
+    }
+
+    if (GetNfpRegisterInfoLocked(&outInfo->registerInfo).IsSuccess()) {
+        *outFlags |= NFPII_TAG_INFO_REGISTER;
+    }
+
+    if (GetNfpReadOnlyInfoLocked(&outInfo->readOnlyInfo).IsSuccess()) {
+        *outFlags |= NFPII_TAG_INFO_READ_ONLY;
+    }
+
+    if (GetNfpAdminInfoLocked(&outInfo->adminInfo).IsSuccess()) {
+        *outFlags |= NFPII_TAG_INFO_ADMIN;
+    }
 
     return NFP_SUCCESS;
 }
 
 Result TagManager::SetNfpRegisterInfo(RegisterInfoSet const& info)
 {
-    Lock lock(&mutex);
+    ManagerLock lock(this);
 
     if (!UpdateInternal()) {
         return NFP_INVALID_STATE;
     }
 
-    if (nfpState != NfpState::Mounted) {
+    if (!IsStateAllowed(NfpOperation::AccessMounted)) {
         return NFP_INVALID_STATE;
     }
 
@@ -764,18 +1004,18 @@ Result TagManager::SetNfpRegisterInfo(RegisterInfoSet const& info)
         return NFP_OUT_OF_RANGE;
     }
 
-    return tag.SetRegisterInfo(info);
+    return tags[currentTagIndex].SetRegisterInfo(info);
 }
 
 Result TagManager::OpenStream(uint32_t id)
 {
-    Lock lock(&mutex);
+    ManagerLock lock(this);
 
     if (!UpdateInternal()) {
         return NFP_INVALID_STATE;
     }
 
-    if (nfpState != NfpState::Mounted) {
+    if (!IsStateAllowed(NfpOperation::AccessMounted)) {
         return NFP_INVALID_STATE;
     }
 
@@ -784,7 +1024,7 @@ Result TagManager::OpenStream(uint32_t id)
 
 Result TagManager::CloseStream()
 {
-    Lock lock(&mutex);
+    ManagerLock lock(this);
 
     if (!UpdateInternal()) {
         return NFP_INVALID_STATE;
@@ -795,13 +1035,13 @@ Result TagManager::CloseStream()
 
 Result TagManager::ReadStream(void* data, uint32_t size)
 {
-    Lock lock(&mutex);
+    ManagerLock lock(this);
 
     if (!UpdateInternal()) {
         return NFP_INVALID_STATE;
     }
 
-    if (nfpState != NfpState::Mounted) {
+    if (!IsStateAllowed(NfpOperation::AccessMounted)) {
         memset(data, 0, size);
         return NFP_INVALID_STATE;
     }
@@ -811,13 +1051,13 @@ Result TagManager::ReadStream(void* data, uint32_t size)
 
 Result TagManager::WriteStream(const void* data, uint32_t size)
 {
-    Lock lock(&mutex);
+    ManagerLock lock(this);
 
     if (!UpdateInternal()) {
         return NFP_INVALID_STATE;
     }
 
-    if (nfpState != NfpState::Mounted) {
+    if (!IsStateAllowed(NfpOperation::AccessMounted)) {
         return NFP_INVALID_STATE;
     }
 
@@ -829,11 +1069,49 @@ void TagManager::Reset()
     hasTag = false;
     readOnly = false;
     activateEvent = nullptr;
+    if (nfpState != NfpState::Uninitialized) {
+        TraceNfpState(nfpState, NfpState::Uninitialized);
+    }
     nfpState = NfpState::Uninitialized;
+    publishedNfpState.store(NfpState::Uninitialized, std::memory_order_release);
     currentTag = nullptr;
     currentTagIndex = 0;
     deactivateEvent = nullptr;
     memset(tagStates, 0, sizeof(tagStates));
+
+    // Drop all resident tags
+    for (Tag& t : tags) {
+        t.ClearTagData();
+        t.SetPath("");
+    }
+    pendingTagSwitch = false;
+}
+
+void TagManager::TraceNfpState(NfpState from, NfpState to)
+{
+    NfpiiStateTransition& entry = stateTrace[stateTraceCount % NFP_STATE_TRACE_SIZE];
+    entry.timeUs = OSTicksToMicroseconds(OSGetSystemTime());
+    entry.fromState = (uint32_t) from;
+    entry.toState = (uint32_t) to;
+    stateTraceCount++;
+}
+
+uint32_t TagManager::GetStateTrace(NfpiiStateTransition* outTransitions, uint32_t maxTransitions)
+{
+    if (!outTransitions) {
+        return 0;
+    }
+
+    ManagerLock lock(this);
+
+    // Copy the newest transitions, oldest first
+    uint32_t count = std::min(stateTraceCount, std::min(maxTransitions, (uint32_t) NFP_STATE_TRACE_SIZE));
+    uint32_t start = stateTraceCount - count;
+    for (uint32_t i = 0; i < count; i++) {
+        outTransitions[i] = stateTrace[(start + i) % NFP_STATE_TRACE_SIZE];
+    }
+
+    return count;
 }
 
 bool TagManager::UpdateInternal()
@@ -849,7 +1127,15 @@ bool TagManager::UpdateInternal()
 
 void TagManager::SetNfpState(NfpState state)
 {
+    if (!IsNfpStateTransitionAllowed(nfpState, state)) {
+        LogHandler::Warn("Unexpected nfpState transition from %u to %u", (uint32_t) nfpState, (uint32_t) state);
+        StatsIncrement(NFPII_STAT_ILLEGAL_STATE_TRANSITIONS);
+    }
+
+    TraceNfpState(nfpState, state);
+
     nfpState = state;
+    publishedNfpState.store(state, std::memory_order_release);
 
     DEBUG_FUNCTION_LINE("Setting nfpState to %u", state);
 
@@ -866,6 +1152,12 @@ void TagManager::Activate()
     if (nfpState == NfpState::Searching) {
         SetNfpState(NfpState::Found);
 
+        if (!firstDetectionDone && firstDetectionStart != 0) {
+            firstDetectionDone = true;
+            StatsAdd(NFPII_STAT_FIRST_DETECTION_TIME_US, OSTicksToMicroseconds(OSGetSystemTime() - firstDetectionStart));
+            StatsAdd(NFPII_STAT_FIRST_DETECTION_PRELOADED, firstDetectionPreloaded ? 1 : 0);
+        }
+
         // nfp would notify IM here, should we do too?
 
         if (activateEvent) {
@@ -876,8 +1168,8 @@ void TagManager::Activate()
 
 void TagManager::Deactivate()
 {
-    if (nfpState == NfpState::Mounted || nfpState == NfpState::MountedROM) {
-        Unmount();
+    if (IsStateAllowed(NfpOperation::Unmount)) {
+        UnmountLocked();
     } else if (nfpState != NfpState::Found) {
         return;
     }
@@ -893,8 +1185,10 @@ void TagManager::Deactivate()
 
 Result TagManager::VerifyTagInfo()
 {
+    AssertLocked();
+
     TagInfo info;
-    Result res = GetTagInfo(&info, currentTagIndex);
+    Result res = GetTagInfoLocked(&info, currentTagIndex);
     if (res.IsFailure()) {
         return res;
     }
@@ -912,14 +1206,20 @@ Result TagManager::GetTagInfo(TagInfo* outTagInfo, uint8_t index)
         return NFP_INVALID_PARAM;
     }
 
-    Lock lock(&mutex);
+    ManagerLock lock(this);
+
+    return GetTagInfoLocked(outTagInfo, index);
+}
+
+Result TagManager::GetTagInfoLocked(TagInfo* outTagInfo, uint8_t index)
+{
+    AssertLocked();
 
     if (!UpdateInternal()) {
         return NFP_INVALID_STATE;
     }
 
-    if (nfpState != NfpState::Found && nfpState != NfpState::Mounted
-       && nfpState != NfpState:: MountedROM) {
+    if (!IsStateAllowed(NfpOperation::GetTagInfo)) {
         return NFP_INVALID_STATE;
     }
 
@@ -932,10 +1232,7 @@ Result TagManager::GetTagInfo(TagInfo* outTagInfo, uint8_t index)
         return RESULT(0xa1b0e180);
     }
 
-    memset(outTagInfo, 0, sizeof(TagInfo));
-
-    NTAGDataT2T* data = tagStates[index].tag->GetData();
-    ReadTagInfo(outTagInfo, data);
+    tagStates[index].tag->GetTagInfo(outTagInfo);
 
     if (outTagInfo->id.size > 10) {
         return NFP_INVALID_TAG_INFO;
@@ -959,11 +1256,11 @@ Result TagManager::MountTag()
 
     tagStream.Close();
 
-    if (currentTag != &tag) {
+    if (currentTag != &tags[currentTagIndex]) {
         return NFP_FATAL;
     }
 
-    res = tag.Mount(!readOnly);
+    res = tags[currentTagIndex].Mount(!readOnly);
     if (res.IsFailure()) {
         return res;
     }
@@ -983,7 +1280,7 @@ Result TagManager::GetAppAreaInfo(Tag::AppAreaInfo* outInfo, uint32_t* outNumAre
         return NFP_INVALID_PARAM;
     }
 
-    if (nfpState != NfpState::Mounted) {
+    if (!IsStateAllowed(NfpOperation::AccessMounted)) {
         memset(outInfo, 0, sizeof(Tag::AppAreaInfo) * maxAreas);
         *outNumAreas = 0;
         return NFP_INVALID_STATE;
@@ -998,8 +1295,8 @@ Result TagManager::GetAppAreaInfo(Tag::AppAreaInfo* outInfo, uint32_t* outNumAre
 
 bool TagManager::CheckRegisterInfo()
 {
-    if (UpdateInternal() && nfpState == NfpState::Mounted) {
-        return tag.HasRegisterInfo();
+    if (UpdateInternal() && IsStateAllowed(NfpOperation::AccessMounted)) {
+        return tags[currentTagIndex].HasRegisterInfo();
     }
 
     return false;
@@ -1008,25 +1305,228 @@ bool TagManager::CheckRegisterInfo()
 void TagManager::NfcProcCallback(OSAlarm* alarm, OSContext* context)
 {
     TagManager* mgr = static_cast<TagManager*>(OSGetAlarmUserData(alarm));
+
+    OSUninterruptibleSpinLock_Acquire(&mgr->nfcProcAlarmLock);
+    if (mgr->procAlarmTime <= OSGetSystemTime()) {
+        // This is the alarm which just fired, unless it was re-armed since
+        mgr->procAlarmTime = 0;
+    }
+    OSUninterruptibleSpinLock_Release(&mgr->nfcProcAlarmLock);
+
     if (!OSTryLockMutex(&mgr->mutex)) {
+        // Someone else is holding the mutex, they wake us up once they release it
+        mgr->DeferProc();
+
+        // In case the mutex was released before the work was deferred, try again later
+        // Don't push out an earlier alarm, like the one of a WakeProc in the meantime
+        OSTime delay = OSMillisecondsToTicks(mgr->procRetryMs);
+        OSUninterruptibleSpinLock_Acquire(&mgr->nfcProcAlarmLock);
+        if (mgr->procAlarmTime == 0 || mgr->procAlarmTime > OSGetSystemTime() + delay) {
+            mgr->SetProcAlarmLocked(delay);
+        }
+        OSUninterruptibleSpinLock_Release(&mgr->nfcProcAlarmLock);
+
+        mgr->procRetryMs = std::min(mgr->procRetryMs * 2, (uint32_t) NFC_PROC_RETRY_MAX_MS);
         return;
     }
 
     Lock lock(&mgr->mutex, true);
 
+    mgr->procRetryMs = NFC_PROC_RETRY_MIN_MS;
+    if (mgr->TakeDeferredProc()) {
+        StatsIncrement(NFPII_STAT_PROC_DEFERRED_RUNS);
+    }
+
+    mgr->RunProc();
+}
+
+void TagManager::RunProc()
+{
+    AssertLocked();
+
+    // The alarm might have been re-armed while finalizing
+    if (!IsInitialized()) {
+        return;
+    }
+
+    StatsIncrement(NFPII_STAT_PROC_WAKEUPS);
+    OSTime start = OSGetSystemTime();
+
     // Handle custom tag updates here
-    mgr->HandleTagUpdates();
+    HandleTagUpdates();
 
     // Handle nfc tag info callbacks
     // The callbacks would usually be called from NFCProc which gets called by NTAGProc,
     // which would be called here, so handling this here is the "most accurate"
-    mgr->HandleNFCGetTagInfo();
+    HandleNFCGetTagInfo();
+
+    ScheduleProc();
+
+    StatsSetMax(NFPII_STAT_PROC_MAX_TIME_US, OSTicksToMicroseconds(OSGetSystemTime() - start));
+}
+
+void TagManager::DeferProc()
+{
+    StatsIncrement(NFPII_STAT_PROC_SKIPPED_TICKS);
+
+    // Only the oldest deferral is kept, the proc handles all pending state at once
+    OSCompareAndSwapAtomic64(&deferredProcTime, 0, OSGetSystemTime());
+}
+
+bool TagManager::TakeDeferredProc()
+{
+    uint64_t deferredTime = OSGetAtomic64(&deferredProcTime);
+    if (deferredTime == 0 || !OSCompareAndSwapAtomic64(&deferredProcTime, deferredTime, 0)) {
+        return false;
+    }
+
+    uint64_t delayUs = OSTicksToMicroseconds(OSGetSystemTime() - (OSTime) deferredTime);
+    if (delayUs < 1000) {
+        StatsIncrement(NFPII_STAT_PROC_DEFER_DELAY_UNDER_1MS);
+    } else if (delayUs < 5000) {
+        StatsIncrement(NFPII_STAT_PROC_DEFER_DELAY_UNDER_5MS);
+    } else if (delayUs < 15000) {
+        StatsIncrement(NFPII_STAT_PROC_DEFER_DELAY_UNDER_15MS);
+    } else {
+        StatsIncrement(NFPII_STAT_PROC_DEFER_DELAY_OVER_15MS);
+    }
+
+    return true;
+}
+
+void TagManager::TagLoadedCallback(void* arg)
+{
+    TagManager* mgr = static_cast<TagManager*>(arg);
+    mgr->WakeProc();
+}
+
+static void UpdateDeadline(OSTime& deadline, OSTime time)
+{
+    if (deadline == 0 || time < deadline) {
+        deadline = time;
+    }
+}
+
+void TagManager::ScheduleProc()
+{
+    AssertLocked();
+
+    OSUninterruptibleSpinLock_Acquire(&nfcProcAlarmLock);
+
+    if (!IsInitialized()) {
+        OSCancelAlarm(&nfcProcAlarm);
+        procAlarmTime = 0;
+        OSUninterruptibleSpinLock_Release(&nfcProcAlarmLock);
+        return;
+    }
+
+    OSTime now = clock->GetTime();
+    OSTime deadline = 0;
+
+    if (config.GetSequence() != appliedConfigSequence) {
+        // The config changed since the last proc
+        UpdateDeadline(deadline, now);
+    }
+
+    // Tag info requests are paced like the original proc
+    OSTime tagInfoTime = nextTagInfoTime > now ? nextTagInfoTime : now;
+    if (newTagInfoRequest || (numTagInfoRequests != 0 && emulationState != NFPII_EMULATION_OFF && hasNfcTagInfo)) {
+        // Tag info requests are answered right away if there is a tag
+        UpdateDeadline(deadline, tagInfoTime);
+    }
+
+    if (nfpState == NfpState::Searching && emulationState != NFPII_EMULATION_OFF && !tagLoader.IsBusy()) {
+        // A tag should be loaded, if the loader is still busy it wakes us up once it's done
+        // The tag is only found once the activation delay passed
+        UpdateDeadline(deadline, activateTime > now ? activateTime : now);
+    }
+
+    if ((pendingRemove || pendingTagSwitch) && IsTagActive()) {
+        // The tag should be removed
+        UpdateDeadline(deadline, now);
+    }
+
+    if (pendingTagRemoveTime != 0) {
+        UpdateDeadline(deadline, pendingTagRemoveTime);
+    }
+
+    if (amiiboSettingsReattachPending && nfpState == NfpState::Searching) {
+        UpdateDeadline(deadline, amiiboSettingsReattachTimeout + 1);
+    }
+
+    // Tag info requests without a tag are answered once they time out
+    // If the loader is reading the tag info, it wakes us up once it's done
+    for (uint32_t i = 0; i < numTagInfoRequests && !tagLoader.IsTagInfoBusy(); i++) {
+        UpdateDeadline(deadline, tagInfoRequests[i].deadline > tagInfoTime ? tagInfoRequests[i].deadline : tagInfoTime);
+    }
+
+    if (deadline == 0) {
+        // Nothing to do until some state changes
+        OSCancelAlarm(&nfcProcAlarm);
+        procAlarmTime = 0;
+    } else {
+        SetProcAlarmLocked(deadline > now ? deadline - now : 0);
+    }
+
+    OSUninterruptibleSpinLock_Release(&nfcProcAlarmLock);
+}
+
+void TagManager::WakeProc()
+{
+    // This is called from the plugin, so don't take the mutex here
+    OSUninterruptibleSpinLock_Acquire(&nfcProcAlarmLock);
+
+    if (IsInitialized()) {
+        SetProcAlarmLocked(0);
+    }
+
+    OSUninterruptibleSpinLock_Release(&nfcProcAlarmLock);
 }
 
-Result TagManager::LoadTag()
+void TagManager::SetProcAlarmLocked(OSTime delay)
+{
+    OSSetAlarmUserData(&nfcProcAlarm, this);
+    OSSetAlarm(&nfcProcAlarm, delay, NfcProcCallback);
+    procAlarmTime = OSGetSystemTime() + delay;
+}
+
+void TagManager::ApplyConfig()
+{
+    // Most of the time nothing changed
+    if (config.GetSequence() == appliedConfigSequence) {
+        return;
+    }
+
+    ConfigSnapshot::Values values;
+    uint32_t seq = config.Read(&values);
+
+    if (values.emulationStateChanges != appliedEmulationStateChanges) {
+        emulationState = values.emulationState;
+        pendingRemove = values.emulationState == NFPII_EMULATION_OFF;
+        appliedEmulationStateChanges = values.emulationStateChanges;
+    }
+
+    // Only publish the sequence once the emulation state matches it
+    appliedConfigSequence = seq;
+
+    uuidRandomizationState = values.uuidRandomizationState;
+    removeAfterSeconds = values.removeAfterSeconds;
+
+    if (tagEmulationPath != values.tagEmulationPath) {
+        tagEmulationPath = values.tagEmulationPath;
+        hasNfcTagInfo = false;
+
+        // Switch to the new tag if a different one is currently presented
+        if (IsTagActive() && currentTag && currentTag->GetPath() != tagEmulationPath) {
+            pendingTagSwitch = true;
+        }
+    }
+}
+
+Result TagManager::LoadTag(bool wait)
 {    
     // Only allow loading tags when we're searching for one for now
-    if (nfpState != NfpState::Searching) {
+    if (!IsStateAllowed(NfpOperation::LoadTag)) {
         return NFP_STATUS_RESULT(0x54321);
     }
 
@@ -1035,41 +1535,46 @@ Result TagManager::LoadTag()
         return NFP_STATUS_RESULT(0x12345);
     }
 
-    // Read the tag
-    NTAGRawDataT2T raw;
-    int res = FSUtils::ReadFromFile(tagEmulationPath.c_str(), &raw, sizeof(raw));
-    // We need at least everything up to the config bytes
-    if (res < 0x214) {
-        DEBUG_FUNCTION_LINE("Failed to read tag data from %s: %x", tagEmulationPath.c_str(), res);
-        LogHandler::Error("Failed to read tag data from %s: %x", tagEmulationPath.c_str(), res);
-        return NFP_STATUS_RESULT(0x12345);
-    }
-
-    // Decrypt the tag
-    NTAGDataT2T data;
-    if (NTAGDecrypt(&data, &raw) != 0) {
-        DEBUG_FUNCTION_LINE("Failed to parse tag");
-        LogHandler::Error("Failed to parse tag");
-        return NFP_STATUS_RESULT(0x12345);
-    }
+    // The tag might still be resident from an earlier detection
+    int32_t slot = FindTagSlot(tagEmulationPath);
+    if (slot >= 0) {
+        StatsIncrement(NFPII_STAT_RESIDENT_TAG_HITS);
 
-    if (!CheckAmiiboMagic(&data)) {
-        tagStates[currentTagIndex].state = 5;
-        DEBUG_FUNCTION_LINE("Invalid tag magic");
-        LogHandler::Error("Invalid tag magic");
-        return NFP_STATUS_RESULT(0x12345);
-    }
+        currentTagIndex = slot;
+        tagSlotLastUse[slot] = ++tagSlotUseCounter;
+    } else {
+        StatsIncrement(NFPII_STAT_RESIDENT_TAG_MISSES);
+
+        NTAGDataT2T data;
+        bool native;
+        Result res;
+        // Use the result of the loader thread if it already loaded the tag
+        if (tagLoader.TakeResult(tagEmulationPath, &data, &native, &res)) {
+            if (!firstDetectionDone) {
+                firstDetectionPreloaded = true;
+            }
+        } else if (wait) {
+            res = tagLoader.Load(tagEmulationPath, &data, &native);
+        } else {
+            // The result was replaced by a load for a different path, the proc tries again
+            // once the loader woke it up
+            tagLoader.Request(tagEmulationPath);
+            return NFP_SUCCESS;
+        }
 
-    // Update tag data
-    tag.SetData(&data);
+        if (res.IsFailure()) {
+            return res;
+        }
 
-    // Update tag path
-    tag.SetPath(tagEmulationPath);
+        res = LoadTagSlot(&data, native);
+        if (res.IsFailure()) {
+            return res;
+        }
+    }
 
     // Simulate a tag read
     tagStates[currentTagIndex].result = 0;
-    tagStates[currentTagIndex].tag = &tag;
-    currentTag = &tag;
+    currentTag = &tags[currentTagIndex];
     hasTag = true;
     tagStates[currentTagIndex].state = 0;
 
@@ -1077,10 +1582,11 @@ Result TagManager::LoadTag()
     Activate();
 
     pendingRemove = false;
+    pendingTagSwitch = false;
 
     // Set time once the tag should be removed
     if (removeAfterSeconds != 0.0f) {
-        pendingTagRemoveTime = OSGetTime() + OSNanosecondsToTicks(removeAfterSeconds * 1e9);
+        pendingTagRemoveTime = clock->GetTime() + OSNanosecondsToTicks(removeAfterSeconds * 1e9);
     } else {
         pendingTagRemoveTime = 0;
     }
@@ -1088,23 +1594,125 @@ Result TagManager::LoadTag()
     return NFP_SUCCESS;
 }
 
+Result TagManager::LoadTagSlot(NTAGDataT2T* data, bool native)
+{
+    currentTagIndex = AllocateTagSlot();
+
+    if (!CheckAmiiboMagic(data)) {
+        tagStates[currentTagIndex].state = 5;
+        DEBUG_FUNCTION_LINE("Invalid tag magic");
+        LogHandler::Error("Invalid tag magic");
+        return NFP_STATUS_RESULT(0x12345);
+    }
+
+    Tag& tag = tags[currentTagIndex];
+
+    // Update tag data
+    tag.SetData(data);
+
+    // Update tag path
+    tag.SetPath(tagEmulationPath);
+    tag.SetNative(native);
+
+    // We now know the tag info of the current tag
+    UpdateNFCTagInfo(tagEmulationPath, data);
+
+    tagStates[currentTagIndex].tag = &tag;
+    tagSlotLastUse[currentTagIndex] = ++tagSlotUseCounter;
+
+    return NFP_SUCCESS;
+}
+
+bool TagManager::CanLoadTagNow()
+{
+    // An empty path fails right away
+    return tagEmulationPath.empty() || FindTagSlot(tagEmulationPath) >= 0 ||
+        tagLoader.HasResult(tagEmulationPath);
+}
+
+int32_t TagManager::FindTagSlot(std::string const& path)
+{
+    for (uint8_t i = 0; i < 3; i++) {
+        if (tagStates[i].tag && tags[i].GetPath() == path) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+uint8_t TagManager::AllocateTagSlot()
+{
+    uint8_t index = 0;
+    for (uint8_t i = 0; i < 3; i++) {
+        // Prefer empty slots
+        if (!tagStates[i].tag) {
+            index = i;
+            break;
+        }
+
+        if (tagSlotLastUse[i] < tagSlotLastUse[index]) {
+            index = i;
+        }
+    }
+
+    ReleaseTagSlot(index);
+    return index;
+}
+
+void TagManager::ReleaseTagSlot(uint8_t index)
+{
+    tags[index].ClearTagData();
+    tags[index].SetPath("");
+    memset(&tagStates[index], 0, sizeof(tagStates[index]));
+    tagSlotLastUse[index] = 0;
+}
+
+bool TagManager::IsTagActive()
+{
+    return NFP_STATES_TAG_ACTIVE & NfpStateBit(nfpState);
+}
+
 void TagManager::HandleTagUpdates()
 {
     // Custom state handling:
 
+    ApplyConfig();
+
     // Check if the tag should be removed
     if (pendingTagRemoveTime != 0) {
-        if (OSGetTime() >= pendingTagRemoveTime) {
+        if (clock->GetTime() >= pendingTagRemoveTime) {
             pendingRemove = true;
             pendingTagRemoveTime = 0;
             emulationState = NFPII_EMULATION_OFF;
         }
     }
 
+    // Re-attach the tag once the amiibo settings timeout expired
+    if (amiiboSettingsReattachPending && nfpState == NfpState::Searching) {
+        if (clock->GetTime() > amiiboSettingsReattachTimeout) {
+            amiiboSettingsReattachPending = false;
+            if (inAmiiboSettings) {
+                emulationState = NFPII_EMULATION_ON;
+            }
+        }
+    }
+
     if (nfpState == NfpState::Searching) {
         // If emulation isn't turned off and we're searching, load the tag
         if (emulationState != NFPII_EMULATION_OFF) {
-            Result res = LoadTag();
+            // Let the loader thread read the tag, we'll be woken up once it's done
+            if (!CanLoadTagNow()) {
+                tagLoader.Request(tagEmulationPath);
+                return;
+            }
+
+            // Wait for the activation delay of the title
+            if (clock->GetTime() < activateTime) {
+                return;
+            }
+
+            Result res = LoadTag(false);
             DEBUG_FUNCTION_LINE("LoadTag: %x", ((NNResult) res).value);
 
             // We still "succeed" on failure but turn off emulation
@@ -1113,60 +1721,287 @@ void TagManager::HandleTagUpdates()
                 emulationState = NFPII_EMULATION_OFF;
             }
         }
-    } else if (nfpState == NfpState::Found || nfpState == NfpState::Mounted ||
-       nfpState == NfpState::MountedROM) {
+    } else if (IsTagActive()) {
         // If emulation was turned off while in a detected state, deactivate the amiibo
         if (pendingRemove) {
             Deactivate();
             pendingRemove = false;
             pendingTagRemoveTime = 0;
             emulationState = NFPII_EMULATION_OFF;
+        } else if (pendingTagSwitch) {
+            // Remove the current tag, the selected one is presented once detection restarts
+            Deactivate();
+            pendingTagSwitch = false;
+            pendingTagRemoveTime = 0;
+        }
+    }
+}
+
+void TagManager::Preload()
+{
+    ManagerLock lock(this);
+
+    // A new application started, measure its first detection again
+    firstDetectionStart = 0;
+    firstDetectionDone = false;
+    firstDetectionPreloaded = false;
+
+    if (IsInitialized() || preloading) {
+        return;
+    }
+
+    ApplyConfig();
+
+    // Only preload if there is a tag which would be presented
+    if (emulationState == NFPII_EMULATION_OFF || tagEmulationPath.empty()) {
+        return;
+    }
+
+    if (FSUtils::Initialize() < 0) {
+        return;
+    }
+
+    LoadAmiiboKeys();
+
+    // The tag file might still be outdated if the journal wasn't replayed yet
+    if (tagWriter.Recover().IsFailure()) {
+        LogHandler::Warn("Failed to recover tag writes from the journal");
+    }
+
+    preloading = true;
+
+    // Initialize takes over the running loader and its result
+    tagLoader.Start(TagLoadedCallback, this);
+    tagLoader.Request(tagEmulationPath);
+}
+
+void TagManager::SetVirtualClockEnabled(bool enabled)
+{
+    ManagerLock lock(this);
+
+    if (enabled == (clock == &virtualClock)) {
+        return;
+    }
+
+    if (enabled) {
+        // Continue from the current time, so pending timeouts stay valid
+        virtualClock.SetTime(systemClock.GetTime());
+        clock = &virtualClock;
+    } else {
+        clock = &systemClock;
+    }
+
+    ScheduleProc();
+}
+
+void TagManager::AdvanceVirtualClock(OSTime ticks)
+{
+    virtualClock.Advance(ticks);
+
+    // Timeouts might have expired now
+    if (clock == &virtualClock) {
+        WakeProc();
+    }
+}
+
+void TagManager::CancelPreload()
+{
+    ManagerLock lock(this);
+
+    if (!preloading) {
+        return;
+    }
+
+    preloading = false;
+
+    tagLoader.Stop();
+    NTAGCloseCryptSession(&cryptSession);
+    FSUtils::Finalize();
+}
+
+Result TagManager::ConvertTag(std::string const& srcPath, std::string const& dstPath, NfpiiTagFormat format)
+{
+    ManagerLock lock(this);
+
+    // The presented tag would write its data over the converted file
+    int32_t slot = FindTagSlot(dstPath);
+    if (srcPath != dstPath && slot >= 0 && currentTag == &tags[slot] && IsTagActive()) {
+        LogHandler::Warn("Can't convert to %s while it's presented", dstPath.c_str());
+        return NFP_INVALID_STATE;
+    }
+
+    // The FS client is only around while nfp is initialized, or while preloading
+    bool initializedFS = false;
+    if (!IsInitialized() && !preloading) {
+        if (FSUtils::Initialize() < 0) {
+            return NFP_SYSTEM_ERROR;
         }
+
+        initializedFS = true;
+    }
+
+    // Make sure the source is up to date
+    tagWriter.Flush();
+
+    NTAGDataT2T data;
+    bool native;
+    Result res = ReadTagFile(&cryptSession, srcPath.c_str(), &data, &native);
+    if (res.IsSuccess()) {
+        res = WriteTagFile(&cryptSession, dstPath.c_str(), &data, format == NFPII_TAG_FORMAT_NATIVE);
+    }
+
+    if (initializedFS) {
+        NTAGCloseCryptSession(&cryptSession);
+        FSUtils::Finalize();
+    }
+
+    if (res.IsFailure()) {
+        return res;
     }
+
+    tagCache.Invalidate(dstPath);
+
+    // The loader might hold the previous data of the destination,
+    // if a load for a different tag was dropped as well, the proc requests it again
+    tagLoader.Clear();
+    ScheduleProc();
+
+    if (slot >= 0) {
+        if (srcPath == dstPath) {
+            // Write the resident tag in the new format, since it was converted in place
+            tags[slot].SetNative(format == NFPII_TAG_FORMAT_NATIVE);
+        } else {
+            // The resident data is outdated now
+            ReleaseTagSlot(slot);
+        }
+    }
+
+    return NFP_SUCCESS;
 }
 
-NFCError TagManager::QueueNFCGetTagInfo(NFCGetTagInfoCallbackFn callback, void* arg)
+NFCError TagManager::QueueNFCGetTagInfo(NFCGetTagInfoCallbackFn callback, void* arg, uint32_t timeout)
 {
-    Lock lock(&mutex);
+    ManagerLock lock(this);
+
+    if (numTagInfoRequests >= NFC_TAG_INFO_QUEUE_SIZE) {
+        LogHandler::Warn("Too many pending NFCGetTagInfo requests");
+        return NFC_TAG_INFO_ERROR;
+    }
 
-    pendingTagInfo = true;
-    nfcTagInfoCallback = callback;
-    nfcTagInfoArg = arg;
+    TagInfoRequest& request = tagInfoRequests[numTagInfoRequests++];
+    request.callback = callback;
+    request.arg = arg;
+    request.deadline = clock->GetTime() + OSMillisecondsToTicks(timeout);
+    newTagInfoRequest = true;
+
+    ScheduleProc();
 
     return 0;
 }
 
+void TagManager::ClearNFCGetTagInfoRequests()
+{
+    ManagerLock lock(this);
+
+    numTagInfoRequests = 0;
+    newTagInfoRequest = false;
+    nextTagInfoTime = 0;
+}
+
 void TagManager::HandleNFCGetTagInfo()
 {
-    if (!pendingTagInfo) {
+    if (numTagInfoRequests == 0) {
         return;
     }
 
-    NFCError err = 0;
-    NFCTagInfo nfcTagInfo{};
+    OSTime now = clock->GetTime();
+    bool timedOut = false;
+    for (uint32_t i = 0; i < numTagInfoRequests; i++) {
+        if (tagInfoRequests[i].deadline <= now) {
+            timedOut = true;
+        }
+    }
+
+    bool tagAvailable = false;
+    NFCTagInfo tagInfo{};
     if (emulationState != NFPII_EMULATION_OFF) {
         // Set time once the tag should be removed, so it works properly in amiibo festival
         if (pendingTagRemoveTime == 0 && removeAfterSeconds != 0.0f) {
-            pendingTagRemoveTime = OSGetTime() + OSNanosecondsToTicks(removeAfterSeconds * 1e9);
+            pendingTagRemoveTime = now + OSNanosecondsToTicks(removeAfterSeconds * 1e9);
         }
 
-        // Read UID from file
-        // TODO: amiibo festival calls this several times, should probably cache the current tag data
-        nfcTagInfo.uidSize = 7;
-        if (FSUtils::ReadFromFile(tagEmulationPath.c_str(), nfcTagInfo.uid, nfcTagInfo.uidSize) != nfcTagInfo.uidSize) {
-            err = -0x1383;
+        // Amiibo festival calls this several times, so only read the UID from the file
+        // if we don't have the tag info for the current path yet
+        // The loader reads the file and wakes us up once it's done, waiting requests don't
+        // retry this on every proc, only once new ones arrive or time out
+        Result res;
+        if (hasNfcTagInfo) {
+            StatsIncrement(NFPII_STAT_NFC_TAG_INFO_CACHE_HITS);
+        } else if (tagLoader.TakeTagInfo(tagEmulationPath, &nfcTagInfo, &res)) {
+            hasNfcTagInfo = res.IsSuccess();
+        } else if (newTagInfoRequest || timedOut) {
+            StatsIncrement(NFPII_STAT_NFC_TAG_INFO_CACHE_MISSES);
+
+            tagLoader.RequestTagInfo(tagEmulationPath);
         }
 
-        nfcTagInfo.technology = NFC_TECHNOLOGY_A;
-        nfcTagInfo.protocol = NFC_PROTOCOL_T2T;
-    } else {
-        err = -0x1383;
+        if (hasNfcTagInfo) {
+            memcpy(&tagInfo, &nfcTagInfo, sizeof(tagInfo));
+            tagAvailable = true;
+        }
     }
 
-    // Clear this before calling the callback, so one can requeue a taginfo request in the callback
-    pendingTagInfo = false;
+    newTagInfoRequest = false;
+
+    if (now < nextTagInfoTime) {
+        // Answered a batch too recently, ScheduleProc comes back once the interval passed
+        return;
+    }
+
+    // If there is a tag all requests are answered at once, otherwise only the ones which timed out
+    // Timed out requests still wait for the loader, if it's reading the tag info
+    bool waitForTagInfo = !tagAvailable && tagLoader.IsTagInfoBusy();
+    TagInfoRequest answered[NFC_TAG_INFO_QUEUE_SIZE];
+    uint32_t numAnswered = 0;
+    uint32_t numRemaining = 0;
+    for (uint32_t i = 0; i < numTagInfoRequests; i++) {
+        if (tagAvailable || (!waitForTagInfo && tagInfoRequests[i].deadline <= now)) {
+            answered[numAnswered++] = tagInfoRequests[i];
+        } else {
+            tagInfoRequests[numRemaining++] = tagInfoRequests[i];
+        }
+    }
+
+    // Remove the requests before calling the callbacks, so one can requeue a taginfo request in the callback
+    numTagInfoRequests = numRemaining;
+
+    if (numAnswered != 0) {
+        nextTagInfoTime = now + OSMillisecondsToTicks(NFC_TAG_INFO_INTERVAL_MS);
+    }
+
+    NFCError err = tagAvailable ? 0 : NFC_TAG_INFO_ERROR;
+    for (uint32_t i = 0; i < numAnswered; i++) {
+        if (!tagAvailable) {
+            StatsIncrement(NFPII_STAT_NFC_TAG_INFO_TIMEOUTS);
+        }
+
+        answered[i].callback(VPAD_CHAN_0, err, &tagInfo, answered[i].arg);
+    }
+}
+
+void TagManager::UpdateNFCTagInfo(std::string const& path, const NTAGDataT2T* data)
+{
+    // Only the tag info of the currently selected tag is kept around
+    if (path != tagEmulationPath) {
+        return;
+    }
 
-    nfcTagInfoCallback(VPAD_CHAN_0, err, &nfcTagInfo, nfcTagInfoArg);
+    memset(&nfcTagInfo, 0, sizeof(nfcTagInfo));
+    nfcTagInfo.uidSize = data->tagInfo.uidSize;
+    memcpy(nfcTagInfo.uid, data->tagInfo.uid, sizeof(nfcTagInfo.uid));
+    nfcTagInfo.technology = data->tagInfo.technology;
+    nfcTagInfo.protocol = data->tagInfo.protocol;
+    hasNfcTagInfo = true;
 }
 
 } // namespace re::nfpii
@@ -1,20 +1,45 @@
 #pragma once
 #include "Tag.hpp"
 #include "TagStream.hpp"
-
+#include "TagCache.hpp"
+#include "TagWriter.hpp"
+#include "TagPrefetcher.hpp"
+#include "TagLoader.hpp"
+#include "ConfigSnapshot.hpp"
+#include "Clock.hpp"
+#include "NfpStateTable.hpp"
+#include "ActivationProfiles.hpp"
+#include "ntag_crypt.h"
+
+#include <atomic>
+#include <cassert>
 #include <string>
 #include <coreinit/mutex.h>
+#include <coreinit/thread.h>
 #include <coreinit/event.h>
 #include <coreinit/alarm.h>
+#include <coreinit/spinlock.h>
+#include <coreinit/atomic64.h>
 
 #include <nfpii.h>
 #include <nfc/nfc.h>
 
+// Number of nfpState transitions kept for NfpiiGetStateTrace
+#define NFP_STATE_TRACE_SIZE 64
+
+// Number of NFCGetTagInfo requests which can be pending at once
+#define NFC_TAG_INFO_QUEUE_SIZE 8
+
+// Minimum time between two batches of NFCGetTagInfo answers, the interval the proc used to run at
+#define NFC_TAG_INFO_INTERVAL_MS 15
+
 namespace re::nfpii {
 using nn::Result;
 using namespace nn::nfp;
 
 class TagManager {
+    friend class ManagerLock;
+
 public:
     TagManager();
     virtual ~TagManager();
@@ -26,6 +51,12 @@ public:
 
     Result GetNfpState(NfpState& state);
 
+    // custom: doesn't take the mutex, for games which poll the state every frame
+    NfpState GetPublishedNfpState() const
+    {
+        return publishedNfpState.load(std::memory_order_acquire);
+    }
+
     Result SetActivateEvent(OSEvent* event);
     Result SetDeactivateEvent(OSEvent* event);
 
@@ -55,6 +86,8 @@ public:
     Result GetNfpReadOnlyInfo(ReadOnlyInfo* outReadOnlyInfo);
     Result GetNfpRomInfo(RomInfo* outRomInfo);
     Result GetNfpAdminInfo(AdminInfo* outAdminInfo);
+    // custom: fills all of the above with a single lock, returns NfpiiTagInfoFlags in outFlags
+    Result GetAllTagInfo(NfpiiAllTagInfo* outInfo, uint32_t* outFlags);
     Result SetNfpRegisterInfo(RegisterInfoSet const& info);
 
     Result OpenStream(uint32_t id);
@@ -63,17 +96,42 @@ public:
     Result WriteStream(const void* data, uint32_t size);
 
 private:
+    // custom: the *Locked variants, and all private functions, need the mutex to be held
+    // They never take the mutex themselves, so a public call only locks once
+    void AssertLocked()
+    {
+        assert(mutex.owner == OSGetCurrentThread());
+    }
+
+    Result StopDetectionLocked();
+    Result UnmountLocked();
+
     void Reset();
 
     bool UpdateInternal();
     void SetNfpState(NfpState state);
 
+    // custom: the state checks of all operations are in the table in NfpStateTable.hpp
+    bool IsStateAllowed(NfpOperation op) const
+    {
+        return IsNfpStateAllowed(op, nfpState);
+    }
+
+    // custom: records a transition in the state trace
+    void TraceNfpState(NfpState from, NfpState to);
+
     void Activate();
     void Deactivate();
 
     Result VerifyTagInfo();
     Result GetTagInfo(TagInfo* outTagInfo, uint8_t index);
 
+    Result GetTagInfoLocked(TagInfo* outTagInfo, uint8_t index);
+    Result GetNfpCommonInfoLocked(CommonInfo* outCommonInfo);
+    Result GetNfpRegisterInfoLocked(RegisterInfo* outRegisterInfo);
+    Result GetNfpReadOnlyInfoLocked(ReadOnlyInfo* outReadOnlyInfo);
+    Result GetNfpAdminInfoLocked(AdminInfo* outAdminInfo);
+
     Result MountTag();
 
     Result GetAppAreaInfo(Tag::AppAreaInfo* outInfo, uint32_t* outNumAreas, int32_t maxAreas);
@@ -82,41 +140,85 @@ private:
 
     static void NfcProcCallback(OSAlarm* alarm, OSContext* context);
 
+    // custom: the work done by the proc alarm
+    void RunProc();
+
+    // custom: if the proc alarm can't take the mutex, it's woken up again once the mutex is released
+    void DeferProc();
+    bool TakeDeferredProc();
+
+    bool HasDeferredProc()
+    {
+        return OSGetAtomic64(&deferredProcTime) != 0;
+    }
+
+    // custom: called by the loader thread once a tag was loaded
+    static void TagLoadedCallback(void* arg);
+
+    // custom: the proc alarm is only armed for the next deadline, instead of running periodically
+    void ScheduleProc();
+    void WakeProc();
+    // Called with nfcProcAlarmLock held
+    void SetProcAlarmLocked(OSTime delay);
+
+    // custom: picks up changes published through the config snapshot
+    void ApplyConfig();
+
+    // custom: resident tag slots
+    int32_t FindTagSlot(std::string const& path);
+    uint8_t AllocateTagSlot();
+    void ReleaseTagSlot(uint8_t index);
+    bool IsTagActive();
+
 public: // custom
+    // These only publish to the config snapshot and never take the mutex,
+    // the proc picks up the changes
     void SetEmulationState(NfpiiEmulationState state)
     {
-        emulationState = state;
-        pendingRemove = state == NFPII_EMULATION_OFF;
+        config.SetEmulationState(state);
+        WakeProc();
     }
 
     NfpiiEmulationState GetEmulationState() const
     {
+        // Report the requested state until the proc picked it up
+        uint32_t applied = appliedConfigSequence;
+        if (config.GetSequence() != applied) {
+            return config.GetEmulationState();
+        }
+
         return emulationState;
     }
 
     void SetUUIDRandomizationState(NfpiiUUIDRandomizationState state)
     {
-        uuidRandomizationState = state;
+        config.SetUUIDRandomizationState(state);
     }
 
     NfpiiUUIDRandomizationState GetUUIDRandomizationState() const
     {
-        return uuidRandomizationState;
+        return config.GetUUIDRandomizationState();
+    }
+
+    void SetTagEmulationPath(const char* path)
+    {
+        config.SetTagEmulationPath(path);
+        WakeProc();
     }
 
-    void SetTagEmulationPath(std::string path)
+    std::string GetTagEmulationPath() const
     {
-        tagEmulationPath = path;
+        return config.GetTagEmulationPath();
     }
 
-    std::string const& GetTagEmulationPath() const
+    const char* GetStableTagEmulationPath() const
     {
-        return tagEmulationPath;
+        return config.GetStableTagEmulationPath();
     }
 
     void SetRemoveAfterSeconds(float secs)
     {
-        this->removeAfterSeconds = secs;
+        config.SetRemoveAfterSeconds(secs);
     }
 
     void SetAmiiboSettings(bool inAmiiboSettings)
@@ -124,18 +226,97 @@ public: // custom
         this->inAmiiboSettings = inAmiiboSettings;
     }
 
-    Result LoadTag();
+    TagCache& GetTagCache()
+    {
+        return tagCache;
+    }
+
+    NTAGCryptSession* GetCryptSession()
+    {
+        return &cryptSession;
+    }
+
+    TagWriter& GetTagWriter()
+    {
+        return tagWriter;
+    }
+
+    TagPrefetcher& GetTagPrefetcher()
+    {
+        return tagPrefetcher;
+    }
+
+    ActivationProfiles& GetActivationProfiles()
+    {
+        return activationProfiles;
+    }
+
+    // If wait is false and the loader doesn't have the tag yet, only requests it from the loader
+    Result LoadTag(bool wait);
+    Result LoadTagSlot(NTAGDataT2T* data, bool native);
+    // Whether LoadTag can finish without waiting for the SD
+    bool CanLoadTagNow();
     void HandleTagUpdates();
 
-    NFCError QueueNFCGetTagInfo(NFCGetTagInfoCallbackFn callback, void* arg);
+    // Starts loading the selected tag before the application initializes nfp
+    void Preload();
+    // Undoes Preload, if the application never initialized nfp
+    void CancelPreload();
+
+    // Time used for all timeouts and the dates written to tags
+    OSTime GetTime()
+    {
+        return clock->GetTime();
+    }
+
+    // Copies the newest nfpState transitions, oldest first
+    uint32_t GetStateTrace(NfpiiStateTransition* outTransitions, uint32_t maxTransitions);
+
+    // Replaces the system clock with a clock which only moves when advanced
+    void SetVirtualClockEnabled(bool enabled);
+    void AdvanceVirtualClock(OSTime ticks);
+
+    Result ConvertTag(std::string const& srcPath, std::string const& dstPath, NfpiiTagFormat format);
+
+    // timeout is in milliseconds, requests are answered with an error if no tag was found until then
+    NFCError QueueNFCGetTagInfo(NFCGetTagInfoCallbackFn callback, void* arg, uint32_t timeout);
+    // Drops all pending requests without calling them, the callbacks belong to the application which ended
+    void ClearNFCGetTagInfoRequests();
     void HandleNFCGetTagInfo();
 
+    void UpdateNFCTagInfo(std::string const& path, const NTAGDataT2T* data);
+
 private:
+    // Lock hierarchy (custom):
+    //  1. mutex: taken once by the public calls and by the proc alarm (which only tries to lock it)
+    //     If the proc alarm fails to lock it, the public call wakes the proc alarm after unlocking
+    //  2. the mutexes of tagLoader, tagPrefetcher, tagWriter, tagCache and cryptSession:
+    //     may be taken while holding mutex, but never take mutex themselves.
+    //     The loader and writer threads only take these
+    //  3. nfcProcAlarmLock: innermost, nothing else is locked while holding it,
+    //     so WakeProc can be called from any thread without taking mutex
     // +0x0
     OSMutex mutex;
 
     // +0xe0
     OSAlarm nfcProcAlarm;
+    // custom: makes checking for config changes and arming the alarm atomic
+    OSSpinLock nfcProcAlarmLock;
+    // custom: system time of the oldest deferred proc, or 0, only accessed atomically
+    volatile uint64_t deferredProcTime;
+    // custom: delay of the next proc retry, only accessed by the proc alarm
+    uint32_t procRetryMs;
+    // custom: system time the proc alarm is armed for, or 0, protected by nfcProcAlarmLock
+    OSTime procAlarmTime;
+
+    // custom: either systemClock or virtualClock
+    Clock* clock;
+    SystemClock systemClock;
+    VirtualClock virtualClock;
+
+    // custom: ring buffer of the last nfpState transitions
+    NfpiiStateTransition stateTrace[NFP_STATE_TRACE_SIZE];
+    uint32_t stateTraceCount;
 
     // +0x15c
     OSEvent* activateEvent;
@@ -143,6 +324,8 @@ private:
 
     // +0x164
     NfpState nfpState;
+    // custom: copy of nfpState which can be read from any thread, only updated by SetNfpState and Reset
+    std::atomic<NfpState> publishedNfpState;
     // +0x170
     Tag::State tagStates[3];
 
@@ -155,23 +338,76 @@ private:
     // +0x1d8
     TagStream::TagStreamImpl tagStreamImpl;
     Tag* currentTag;
-    Tag tag;
+    // custom: one tag per tagStates slot, so up to three tags can stay resident
+    Tag tags[3];
     TagStream tagStream;
 
 private: // custom
-    NfpiiEmulationState emulationState;
+    ConfigSnapshot config;
+    // Sequence of the config values below
+    // GetEmulationState reads this and emulationState without the mutex, so the proc
+    // updates emulationState first and publishes the sequence afterwards
+    std::atomic<uint32_t> appliedConfigSequence;
+    uint32_t appliedEmulationStateChanges;
+
+    std::atomic<NfpiiEmulationState> emulationState;
     NfpiiUUIDRandomizationState uuidRandomizationState;
     std::string tagEmulationPath;
     float removeAfterSeconds;
     bool pendingRemove;
+    // A different tag was selected while one is active
+    bool pendingTagSwitch;
     OSTime pendingTagRemoveTime;
 
-    bool pendingTagInfo;
-    NFCGetTagInfoCallbackFn nfcTagInfoCallback;
-    void* nfcTagInfoArg;
+    struct TagInfoRequest {
+        NFCGetTagInfoCallbackFn callback;
+        void* arg;
+        OSTime deadline;
+    };
+
+    // Pending NFCGetTagInfo requests, oldest first
+    TagInfoRequest tagInfoRequests[NFC_TAG_INFO_QUEUE_SIZE];
+    uint32_t numTagInfoRequests;
+    // A request was queued since the last proc
+    bool newTagInfoRequest;
+    // Requests aren't answered before this, so requeuing from the callback doesn't keep the proc spinning
+    OSTime nextTagInfoTime;
+
+    // Tag info of the tag at tagEmulationPath, so we don't have to access the SD for every request
+    bool hasNfcTagInfo;
+    NFCTagInfo nfcTagInfo;
 
     bool inAmiiboSettings;
     OSTime amiiboSettingsReattachTimeout;
+    bool amiiboSettingsReattachPending;
+
+    ActivationProfiles activationProfiles;
+    // Profile of the running title, looked up once detection starts
+    NfpiiActivationProfile activationProfile;
+    // The tag isn't found before this time
+    OSTime activateTime;
+
+    TagCache tagCache;
+
+    // Used to find the least recently used resident tag
+    uint32_t tagSlotUseCounter;
+    uint32_t tagSlotLastUse[3];
+
+    NTAGCryptSession cryptSession;
+
+    TagWriter tagWriter;
+
+    TagPrefetcher tagPrefetcher;
+
+    TagLoader tagLoader;
+
+    // The FS client and loader were started by Preload
+    bool preloading;
+
+    // Latency of the first detection after the application started
+    OSTime firstDetectionStart;
+    bool firstDetectionDone;
+    bool firstDetectionPreloaded;
 };
 
 } // namespace re::nfpii
@@ -0,0 +1,229 @@
+#include "TagPrefetcher.hpp"
+#include "TagFile.hpp"
+#include "Lock.hpp"
+#include "utils/FSUtils.hpp"
+#include "utils/stats.h"
+
+#include <cstring>
+
+namespace re::nfpii {
+
+static_assert(TAG_PREFETCH_NUM_ENTRIES > 0, "Prefetch budget is too small");
+
+TagPrefetcher::TagPrefetcher(NTAGCryptSession* session)
+ : session(session)
+{
+    OSInitMutex(&mutex);
+    OSInitEvent(&workEvent, FALSE, OS_EVENT_MODE_AUTO);
+
+    running = false;
+
+    for (Entry& e : entries) {
+        e.state = ENTRY_STATE_EMPTY;
+        e.generation = 0;
+        e.size = 0;
+        e.modified = 0;
+        e.native = false;
+        memset(&e.data, 0, sizeof(e.data));
+    }
+}
+
+TagPrefetcher::~TagPrefetcher()
+{
+}
+
+void TagPrefetcher::Start()
+{
+    Lock lock(&mutex);
+
+    if (running) {
+        return;
+    }
+
+    running = true;
+    OSCreateThread(&thread, ThreadEntry, 1, (char*) this, stack + sizeof(stack), sizeof(stack), TAG_PREFETCH_THREAD_PRIORITY, OS_THREAD_ATTRIB_AFFINITY_ANY);
+    OSSetThreadName(&thread, "re_nfpii TagPrefetcher");
+    OSResumeThread(&thread);
+}
+
+void TagPrefetcher::Stop()
+{
+    {
+        Lock lock(&mutex);
+
+        if (!running) {
+            return;
+        }
+
+        running = false;
+        OSSignalEvent(&workEvent);
+    }
+
+    // The thread only finishes the tag it's currently loading
+    OSJoinThread(&thread, nullptr);
+}
+
+uint32_t TagPrefetcher::SetTags(const char* const* paths, uint32_t numPaths)
+{
+    Lock lock(&mutex);
+
+    if (numPaths > TAG_PREFETCH_NUM_ENTRIES) {
+        numPaths = TAG_PREFETCH_NUM_ENTRIES;
+    }
+
+    // Drop entries which aren't in the new list, so already prefetched tags are kept
+    for (Entry& e : entries) {
+        if (e.state == ENTRY_STATE_EMPTY) {
+            continue;
+        }
+
+        bool keep = false;
+        for (uint32_t i = 0; i < numPaths; i++) {
+            if (paths[i] && e.path == paths[i]) {
+                keep = true;
+                break;
+            }
+        }
+
+        if (!keep) {
+            e.state = ENTRY_STATE_EMPTY;
+            e.generation++;
+            e.path.clear();
+        }
+    }
+
+    for (uint32_t i = 0; i < numPaths; i++) {
+        if (!paths[i] || Find(paths[i])) {
+            continue;
+        }
+
+        for (Entry& e : entries) {
+            if (e.state == ENTRY_STATE_EMPTY) {
+                e.state = ENTRY_STATE_PENDING;
+                e.generation++;
+                e.path = paths[i];
+                break;
+            }
+        }
+    }
+
+    OSSignalEvent(&workEvent);
+
+    return numPaths;
+}
+
+bool TagPrefetcher::Get(std::string const& path, FSAStat const& stat, NTAGDataT2T* outData, bool* outNative)
+{
+    Lock lock(&mutex);
+
+    Entry* e = Find(path);
+    if (!e || e->state != ENTRY_STATE_READY) {
+        return false;
+    }
+
+    // File was modified since it was prefetched, load it again
+    if (e->size != stat.size || e->modified != (uint64_t) stat.modified) {
+        e->state = ENTRY_STATE_PENDING;
+        OSSignalEvent(&workEvent);
+        return false;
+    }
+
+    StatsIncrement(NFPII_STAT_PREFETCH_HITS);
+
+    memcpy(outData, &e->data, sizeof(NTAGDataT2T));
+    *outNative = e->native;
+    return true;
+}
+
+bool TagPrefetcher::IsPrefetched(std::string const& path)
+{
+    Lock lock(&mutex);
+
+    Entry* e = Find(path);
+    return e && e->state == ENTRY_STATE_READY;
+}
+
+TagPrefetcher::Entry* TagPrefetcher::Find(std::string const& path)
+{
+    for (Entry& e : entries) {
+        if (e.state != ENTRY_STATE_EMPTY && e.path == path) {
+            return &e;
+        }
+    }
+
+    return nullptr;
+}
+
+TagPrefetcher::Entry* TagPrefetcher::NextPending()
+{
+    for (Entry& e : entries) {
+        if (e.state == ENTRY_STATE_PENDING) {
+            return &e;
+        }
+    }
+
+    return nullptr;
+}
+
+void TagPrefetcher::Load(Entry* e)
+{
+    // Called with mutex locked
+    std::string path = e->path;
+    uint32_t generation = e->generation;
+    e->state = ENTRY_STATE_LOADING;
+
+    OSUnlockMutex(&mutex);
+
+    NTAGDataT2T data;
+    bool native = false;
+    FSAStat stat;
+    bool success = FSUtils::GetStat(path.c_str(), &stat) == 0 &&
+        ReadTagFile(session, path.c_str(), &data, &native).IsSuccess();
+
+    StatsIncrement(NFPII_STAT_PREFETCH_LOADS);
+
+    OSLockMutex(&mutex);
+
+    // The entry was dropped or reused while loading
+    if (e->generation != generation || e->state != ENTRY_STATE_LOADING) {
+        return;
+    }
+
+    if (!success) {
+        e->state = ENTRY_STATE_FAILED;
+        return;
+    }
+
+    e->size = stat.size;
+    e->modified = stat.modified;
+    e->native = native;
+    memcpy(&e->data, &data, sizeof(NTAGDataT2T));
+    e->state = ENTRY_STATE_READY;
+}
+
+void TagPrefetcher::Run()
+{
+    Lock lock(&mutex);
+
+    while (running) {
+        Entry* e = NextPending();
+        if (e) {
+            Load(e);
+            continue;
+        }
+
+        // Nothing to do, so wait for a new list
+        OSUnlockMutex(&mutex);
+        OSWaitEvent(&workEvent);
+        OSLockMutex(&mutex);
+    }
+}
+
+int TagPrefetcher::ThreadEntry(int argc, const char** argv)
+{
+    TagPrefetcher* prefetcher = (TagPrefetcher*) argv;
+    prefetcher->Run();
+    return 0;
+}
+
+} // namespace re::nfpii
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "ntag_crypt.h"
+
+#include <nn/nfp.h>
+#include <ntag/ntag.h>
+#include <coreinit/mutex.h>
+#include <coreinit/event.h>
+#include <coreinit/thread.h>
+#include <coreinit/filesystem_fsa.h>
+
+#include <string>
+
+namespace re::nfpii {
+using nn::Result;
+
+// Memory which can be used for prefetched tag data
+#define TAG_PREFETCH_MEMORY_BUDGET 0x2000
+
+// Number of tags which can be prefetched at the same time
+#define TAG_PREFETCH_NUM_ENTRIES (TAG_PREFETCH_MEMORY_BUDGET / sizeof(NTAGDataT2T))
+
+// Stack size of the prefetch thread
+#define TAG_PREFETCH_STACK_SIZE 0x4000
+
+// Priority of the prefetch thread, so it doesn't get in the way of the game
+#define TAG_PREFETCH_THREAD_PRIORITY 30
+
+// Reads and decrypts a list of tags (the favorites of the plugin) in the background,
+// so they can be presented without reading them from the SD first
+// Like the TagCache, entries are only valid while the file on the SD didn't change
+class TagPrefetcher {
+public:
+    TagPrefetcher(NTAGCryptSession* session);
+    virtual ~TagPrefetcher();
+
+    void Start();
+    void Stop();
+
+    // Replaces the list of tags to prefetch
+    // Returns how many of the paths fit into the budget
+    uint32_t SetTags(const char* const* paths, uint32_t numPaths);
+
+    bool Get(std::string const& path, FSAStat const& stat, NTAGDataT2T* outData, bool* outNative);
+
+    bool IsPrefetched(std::string const& path);
+
+private:
+    enum EntryState {
+        ENTRY_STATE_EMPTY,
+        ENTRY_STATE_PENDING,
+        ENTRY_STATE_LOADING,
+        ENTRY_STATE_READY,
+        ENTRY_STATE_FAILED,
+    };
+
+    struct Entry {
+        EntryState state;
+        // Incremented whenever the entry is reused, so stale loads are dropped
+        uint32_t generation;
+        std::string path;
+        uint32_t size;
+        uint64_t modified;
+        bool native;
+        NTAGDataT2T data;
+    };
+
+    Entry* Find(std::string const& path);
+    Entry* NextPending();
+
+    void Load(Entry* e);
+
+    void Run();
+    static int ThreadEntry(int argc, const char** argv);
+
+    NTAGCryptSession* session;
+
+    OSMutex mutex;
+    OSEvent workEvent;
+
+    bool running;
+    Entry entries[TAG_PREFETCH_NUM_ENTRIES];
+
+    OSThread thread;
+    __attribute__((aligned(8))) uint8_t stack[TAG_PREFETCH_STACK_SIZE];
+};
+
+} // namespace re::nfpii
@@ -0,0 +1,435 @@
+#include "TagWriter.hpp"
+#include "Lock.hpp"
+#include "re_nfpii.hpp"
+#include "utils/FSUtils.hpp"
+#include "utils/LogHandler.hpp"
+#include "utils/stats.h"
+
+#include <cstring>
+#include <coreinit/time.h>
+
+namespace re::nfpii {
+
+TagWriter::TagWriter(TagCache* cache, NTAGCryptSession* session)
+ : cache(cache), session(session)
+{
+    OSInitMutex(&mutex);
+    OSInitEvent(&workEvent, FALSE, OS_EVENT_MODE_AUTO);
+    OSInitCond(&idleCond);
+    OSInitMutex(&ioMutex);
+
+    running = false;
+    compactRequested = false;
+    compactFailed = false;
+    sequence = 0;
+    lastResult = NFP_SUCCESS;
+
+    for (Entry& e : entries) {
+        e.pending = false;
+        e.writing = false;
+        e.journaled = false;
+        e.sequence = 0;
+        e.native = false;
+        memset(&e.data, 0, sizeof(e.data));
+        e.fileSize = 0;
+    }
+}
+
+TagWriter::~TagWriter()
+{
+}
+
+Result TagWriter::Recover()
+{
+    Lock ioLock(&ioMutex);
+
+    Result res = journal.Replay();
+    if (res.IsFailure()) {
+        // The writer retries the replay once it compacts the journal
+        return res;
+    }
+
+    return journal.Reset();
+}
+
+void TagWriter::Start()
+{
+    Lock lock(&mutex);
+
+    if (running) {
+        return;
+    }
+
+    running = true;
+    OSCreateThread(&thread, ThreadEntry, 1, (char*) this, stack + sizeof(stack), sizeof(stack), 17, OS_THREAD_ATTRIB_AFFINITY_ANY);
+    OSSetThreadName(&thread, "re_nfpii TagWriter");
+    OSResumeThread(&thread);
+}
+
+void TagWriter::Stop()
+{
+    {
+        Lock lock(&mutex);
+
+        if (!running) {
+            return;
+        }
+
+        // The thread finishes all queued writes and compacts the journal before exiting
+        running = false;
+        OSSignalEvent(&workEvent);
+    }
+
+    OSJoinThread(&thread, nullptr);
+}
+
+void TagWriter::Queue(std::string const& path, const NTAGDataT2T* data, bool native)
+{
+    Lock lock(&mutex);
+
+    StatsIncrement(NFPII_STAT_TAG_WRITES_QUEUED);
+
+    Entry* e = Find(path);
+    if (e && e->pending) {
+        // The previous data wasn't written yet, so just replace it
+        StatsIncrement(NFPII_STAT_TAG_WRITES_COALESCED);
+    } else if (!e) {
+        // Wait for a free entry, journaled entries are freed by compacting the journal
+        while (running && !(e = FindFree())) {
+            if (compactFailed) {
+                // The journaled entries can't be written back right now, don't wait for them
+                break;
+            }
+
+            compactRequested = true;
+            OSSignalEvent(&workEvent);
+            OSWaitCond(&idleCond, &mutex);
+        }
+
+        if (!e) {
+            // Without a thread or a free entry there is nothing which would process the entry, write it directly
+            NTAGDataT2T tmp;
+            memcpy(&tmp, data, sizeof(NTAGDataT2T));
+            Result res = WriteTagFile(session, path.c_str(), &tmp, native);
+            if (res.IsFailure()) {
+                StatsIncrement(NFPII_STAT_TAG_WRITE_FAILURES);
+                cache->Invalidate(path);
+                lastResult = res;
+            } else {
+                journal.Supersede(path);
+            }
+            return;
+        }
+
+        e->path = path;
+    }
+
+    e->pending = true;
+    e->sequence = ++sequence;
+    e->native = native;
+    memcpy(&e->data, data, sizeof(NTAGDataT2T));
+
+    // The file on the SD is outdated now
+    cache->Invalidate(path);
+
+    OSSignalEvent(&workEvent);
+}
+
+bool TagWriter::Get(std::string const& path, NTAGDataT2T* outData, bool* outNative)
+{
+    Lock lock(&mutex);
+
+    Entry* e = Find(path);
+    if (!e) {
+        return false;
+    }
+
+    memcpy(outData, &e->data, sizeof(NTAGDataT2T));
+    *outNative = e->native;
+    return true;
+}
+
+Result TagWriter::Drain()
+{
+    Lock lock(&mutex);
+
+    while (running && !IsIdle()) {
+        OSWaitCond(&idleCond, &mutex);
+    }
+
+    Result res = lastResult;
+    lastResult = NFP_SUCCESS;
+    return res;
+}
+
+Result TagWriter::TakeLastResult()
+{
+    Lock lock(&mutex);
+
+    Result res = lastResult;
+    lastResult = NFP_SUCCESS;
+    return res;
+}
+
+Result TagWriter::Flush()
+{
+    Result res = Drain();
+
+    Lock ioLock(&ioMutex);
+    Lock lock(&mutex);
+
+    Result compactRes = Compact();
+    if (compactRes.IsFailure()) {
+        return compactRes;
+    }
+
+    return res;
+}
+
+TagWriter::Entry* TagWriter::Find(std::string const& path)
+{
+    for (Entry& e : entries) {
+        if ((e.pending || e.writing || e.journaled) && e.path == path) {
+            return &e;
+        }
+    }
+
+    return nullptr;
+}
+
+TagWriter::Entry* TagWriter::FindFree()
+{
+    for (Entry& e : entries) {
+        if (!e.pending && !e.writing && !e.journaled) {
+            return &e;
+        }
+    }
+
+    return nullptr;
+}
+
+TagWriter::Entry* TagWriter::NextPending()
+{
+    // Write the entries in the order they were queued in
+    Entry* next = nullptr;
+    for (Entry& e : entries) {
+        if (e.pending && !e.writing && (!next || e.sequence < next->sequence)) {
+            next = &e;
+        }
+    }
+
+    return next;
+}
+
+bool TagWriter::IsIdle()
+{
+    for (Entry& e : entries) {
+        if (e.pending || e.writing) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+Result TagWriter::Write(Entry* e)
+{
+    // Called with ioMutex and mutex locked
+    // Take a snapshot, so the tag can be queued again while it's being written
+    std::string path = e->path;
+    bool native = e->native;
+    memcpy(&writeData, &e->data, sizeof(NTAGDataT2T));
+    e->pending = false;
+    e->writing = true;
+
+    // Don't let the journal grow any further while it can't be folded back
+    bool useJournal = !compactFailed || journal.GetNumRecords() < TAG_JOURNAL_MAX_RECORDS;
+
+    OSUnlockMutex(&mutex);
+
+    OSTime start = OSGetSystemTime();
+
+    uint32_t fileSize;
+    Result res = EncodeTagFile(session, &writeData, native, fileBuffer, &fileSize);
+    bool journaled = false;
+    bool appendFailed = false;
+    if (res.IsSuccess()) {
+        journaled = useJournal && journal.Append(path, fileBuffer, fileSize).IsSuccess();
+        appendFailed = useJournal && !journaled;
+        if (!journaled) {
+            // Still try to get the data on the SD
+            res = WriteTagFileData(path.c_str(), fileBuffer, fileSize);
+            if (res.IsSuccess()) {
+                journal.Supersede(path);
+            }
+        }
+    }
+
+    uint64_t us = OSTicksToMicroseconds(OSGetSystemTime() - start);
+    StatsIncrement(NFPII_STAT_TAG_WRITES);
+    StatsSetMax(NFPII_STAT_TAG_WRITE_MAX_TIME_US, us);
+
+    OSLockMutex(&mutex);
+
+    e->writing = false;
+
+    if (appendFailed) {
+        // The append might have left a partial record behind, get rid of it soon
+        compactRequested = true;
+    }
+
+    if (res.IsFailure()) {
+        StatsIncrement(NFPII_STAT_TAG_WRITE_FAILURES);
+        lastResult = res;
+    } else if (journaled) {
+        // Keep the data around until it was folded back into the tag file
+        e->journaled = true;
+        e->fileSize = fileSize;
+        memcpy(e->fileData, fileBuffer, fileSize);
+    } else if (!e->pending) {
+        // Written directly to the tag file
+        FSAStat stat;
+        if (FSUtils::GetStat(path.c_str(), &stat) == 0) {
+            cache->Put(path, stat, &writeData, native);
+        }
+    }
+
+    OSSignalCond(&idleCond);
+    return res;
+}
+
+Result TagWriter::Compact()
+{
+    // Called with ioMutex and mutex locked
+    compactRequested = false;
+
+    bool hasJournaled = false;
+    for (Entry& e : entries) {
+        if (e.journaled) {
+            hasJournaled = true;
+            break;
+        }
+    }
+
+    if (!hasJournaled && journal.IsEmpty()) {
+        compactFailed = false;
+        return NFP_SUCCESS;
+    }
+
+    // The journaled data of an entry is only changed with ioMutex held,
+    // so Queue and Get don't have to wait for the SD
+    OSUnlockMutex(&mutex);
+
+    Result res = NFP_SUCCESS;
+
+    // Records which couldn't be replayed don't have an entry, so retry the replay first.
+    // The entries are written afterwards, since they contain the latest data.
+    if (journal.NeedsReplay() && journal.Replay().IsFailure()) {
+        res = NFP_SYSTEM_ERROR;
+    }
+
+    bool written[TAG_WRITER_NUM_ENTRIES] = {};
+    for (int i = 0; i < TAG_WRITER_NUM_ENTRIES; i++) {
+        Entry& e = entries[i];
+        if (!e.journaled) {
+            continue;
+        }
+
+        if (WriteTagFileData(e.path.c_str(), e.fileData, e.fileSize).IsSuccess()) {
+            written[i] = true;
+        } else {
+            res = NFP_SYSTEM_ERROR;
+        }
+    }
+
+    // If a tag file couldn't be written, the journal needs to stay around
+    if (res.IsSuccess()) {
+        res = journal.Reset();
+    } else {
+        LogHandler::Error("Failed to compact the tag journal");
+    }
+
+    OSLockMutex(&mutex);
+
+    compactFailed = res.IsFailure();
+    if (!compactFailed) {
+        StatsIncrement(NFPII_STAT_JOURNAL_COMPACTIONS);
+    }
+
+    // Entries which are in their tag files can be released, even if the journal has to stay around.
+    // Only the ones which failed keep their data, so the next compaction retries them.
+    for (int i = 0; i < TAG_WRITER_NUM_ENTRIES; i++) {
+        Entry& e = entries[i];
+        if (!e.journaled || !written[i]) {
+            continue;
+        }
+
+        e.journaled = false;
+
+        // Keep the cache in sync with the SD, unless newer data was queued in the meantime
+        if (!e.pending) {
+            FSAStat stat;
+            if (FSUtils::GetStat(e.path.c_str(), &stat) == 0) {
+                cache->Put(e.path, stat, &e.data, e.native);
+            }
+        }
+    }
+
+    // Entries are free again, wake up Queue even if nothing could be released,
+    // so it doesn't keep waiting for a compaction which failed
+    OSSignalCond(&idleCond);
+    return res;
+}
+
+void TagWriter::Run()
+{
+    Lock ioLock(&ioMutex);
+    Lock lock(&mutex);
+
+    while (true) {
+        // After a failed compaction, only retry once requested or idle again
+        if (compactRequested || (!compactFailed && journal.GetNumRecords() >= TAG_JOURNAL_MAX_RECORDS)) {
+            Compact();
+        }
+
+        Entry* e = NextPending();
+        if (e) {
+            Write(e);
+            continue;
+        }
+
+        if (!running) {
+            break;
+        }
+
+        // Nothing to do, so wait for new writes
+        OSUnlockMutex(&mutex);
+        OSUnlockMutex(&ioMutex);
+
+        // The timeout is in nanoseconds, not ticks
+        bool signaled = OSWaitEventWithTimeout(&workEvent, TAG_WRITER_COMPACT_DELAY_MS * 1000000ull);
+
+        OSLockMutex(&ioMutex);
+        OSLockMutex(&mutex);
+
+        // No writes for a while, fold the journal back into the tag files
+        if (!signaled) {
+            Compact();
+        }
+    }
+
+    // Make sure everything is in the tag files before the SD gets unmounted
+    Compact();
+
+    // Wake up anyone waiting for a free entry or a drain
+    OSSignalCond(&idleCond);
+}
+
+int TagWriter::ThreadEntry(int argc, const char** argv)
+{
+    TagWriter* writer = (TagWriter*) argv;
+    writer->Run();
+    return 0;
+}
+
+} // namespace re::nfpii
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "TagCache.hpp"
+#include "TagFile.hpp"
+#include "TagJournal.hpp"
+#include "ntag_crypt.h"
+
+#include <nn/nfp.h>
+#include <ntag/ntag.h>
+#include <coreinit/mutex.h>
+#include <coreinit/condition.h>
+#include <coreinit/event.h>
+#include <coreinit/thread.h>
+
+#include <string>
+
+namespace re::nfpii {
+using nn::Result;
+
+// Number of different tags which can have a write pending at the same time
+#define TAG_WRITER_NUM_ENTRIES 4
+
+// Stack size of the writer thread
+#define TAG_WRITER_STACK_SIZE 0x4000
+
+// Time without any writes, after which the journal is compacted
+#define TAG_WRITER_COMPACT_DELAY_MS 2000
+
+// Writes tags to the SD in the background
+// Every queued write is a snapshot of the tag data. If a tag is written
+// again before the previous data reached the SD, only the latest data is
+// written.
+// Writes are appended to the journal first and folded back into the tag
+// files once the writer is idle, or stopped.
+class TagWriter {
+public:
+    TagWriter(TagCache* cache, NTAGCryptSession* session);
+    virtual ~TagWriter();
+
+    // Replays the journal of a previous session, needs to be called before Start
+    Result Recover();
+
+    void Start();
+    void Stop();
+
+    void Queue(std::string const& path, const NTAGDataT2T* data, bool native);
+
+    // Returns the latest data queued for path, if it wasn't written to the tag file yet
+    bool Get(std::string const& path, NTAGDataT2T* outData, bool* outNative);
+
+    // Waits until all queued writes are in the journal
+    // Returns a failure if any write failed since the last drain
+    Result Drain();
+
+    // Same as Drain, but doesn't wait for the queued writes
+    Result TakeLastResult();
+
+    // Waits until all queued writes are written to the tag files
+    Result Flush();
+
+private:
+    struct Entry {
+        // Contains data which still needs to be written
+        bool pending;
+        // Data is currently being written by the thread
+        bool writing;
+        // fileData is in the journal, but not in the tag file yet
+        bool journaled;
+        uint32_t sequence;
+        std::string path;
+        bool native;
+        NTAGDataT2T data;
+
+        uint32_t fileSize;
+        __attribute__((aligned(0x40))) uint8_t fileData[TAG_FILE_MAX_SIZE];
+    };
+
+    Entry* Find(std::string const& path);
+    Entry* FindFree();
+    Entry* NextPending();
+    bool IsIdle();
+
+    Result Write(Entry* e);
+    Result Compact();
+
+    void Run();
+    static int ThreadEntry(int argc, const char** argv);
+
+    TagCache* cache;
+    NTAGCryptSession* session;
+    TagJournal journal;
+
+    OSMutex mutex;
+    OSEvent workEvent;
+    OSCondition idleCond;
+
+    // Serializes access to the journal and the tag files
+    OSMutex ioMutex;
+
+    bool running;
+    bool compactRequested;
+    // The last compaction couldn't write all journaled entries back
+    bool compactFailed;
+    uint32_t sequence;
+    Result lastResult;
+    Entry entries[TAG_WRITER_NUM_ENTRIES];
+
+    // Protected by ioMutex
+    NTAGDataT2T writeData;
+    __attribute__((aligned(0x40))) uint8_t fileBuffer[TAG_FILE_MAX_SIZE];
+
+    OSThread thread;
+    __attribute__((aligned(8))) uint8_t stack[TAG_WRITER_STACK_SIZE];
+};
+
+} // namespace re::nfpii
@@ -1,6 +1,7 @@
 #include "re_nfpii.hpp"
 #include "Cabinet.hpp"
 #include "Utils.hpp"
+#include "CallProfiler.hpp"
 #include "debug/logger.h"
 
 #include <wums.h>
@@ -15,6 +16,8 @@ TagManager tagManager;
 
 Result Initialize()
 {
+    CallProfiler profiler(NFPII_CALL_INITIALIZE);
+
     DEBUG_FUNCTION_LINE("nn::nfp::Initialize");
 
     // TODO initialize act
@@ -24,6 +27,8 @@ Result Initialize()
 
 Result Finalize()
 {
+    CallProfiler profiler(NFPII_CALL_FINALIZE);
+
     DEBUG_FUNCTION_LINE("nn::nfp::Finalize");
 
     // TODO finalize act
@@ -33,8 +38,10 @@ Result Finalize()
 
 NfpState GetNfpState()
 {
-    NfpState state;
-    tagManager.GetNfpState(state);
+    CallProfiler profiler(NFPII_CALL_GET_NFP_STATE);
+
+    // Called every frame by a lot of games, so don't go through the manager
+    NfpState state = tagManager.GetPublishedNfpState();
 
     //DEBUG_FUNCTION_LINE_WRITE("nn::nfp::GetNfpState: %u", state);
     return state;
@@ -56,6 +63,8 @@ Result SetDeactivateEvent(OSEvent* event)
 
 Result StartDetection()
 {
+    CallProfiler profiler(NFPII_CALL_START_DETECTION);
+
     DEBUG_FUNCTION_LINE("nn::nfp::StartDetection");
 
     return tagManager.StartDetection();
@@ -63,6 +72,8 @@ Result StartDetection()
 
 Result StopDetection()
 {
+    CallProfiler profiler(NFPII_CALL_STOP_DETECTION);
+
     DEBUG_FUNCTION_LINE("nn::nfp::StopDetection");
 
     return tagManager.StopDetection();
@@ -70,6 +81,8 @@ Result StopDetection()
 
 Result Mount()
 {
+    CallProfiler profiler(NFPII_CALL_MOUNT);
+
     DEBUG_FUNCTION_LINE("nn::nfp::Mount");
 
     return tagManager.Mount();
@@ -77,6 +90,8 @@ Result Mount()
 
 Result MountReadOnly()
 {
+    CallProfiler profiler(NFPII_CALL_MOUNT_READ_ONLY);
+
     DEBUG_FUNCTION_LINE("nn::nfp::MountReadOnly");
 
     return tagManager.MountReadOnly();
@@ -84,6 +99,8 @@ Result MountReadOnly()
 
 Result MountRom()
 {
+    CallProfiler profiler(NFPII_CALL_MOUNT_ROM);
+
     DEBUG_FUNCTION_LINE("nn::nfp::MountRom");
 
     return tagManager.MountRom();
@@ -91,6 +108,8 @@ Result MountRom()
 
 Result Unmount()
 {
+    CallProfiler profiler(NFPII_CALL_UNMOUNT);
+
     DEBUG_FUNCTION_LINE("nn::nfp::Unmount");
 
     return tagManager.Unmount();
@@ -98,6 +117,8 @@ Result Unmount()
 
 Result Flush()
 {
+    CallProfiler profiler(NFPII_CALL_FLUSH);
+
     DEBUG_FUNCTION_LINE("nn::nfp::Flush");
 
     return tagManager.Flush();
@@ -126,6 +147,8 @@ bool IsExistApplicationArea()
 
 Result CreateApplicationArea(ApplicationAreaCreateInfo const& createInfo)
 {
+    CallProfiler profiler(NFPII_CALL_CREATE_APPLICATION_AREA);
+
     DEBUG_FUNCTION_LINE("nn::nfp::CreateApplicationArea");
 
     return tagManager.CreateApplicationArea(createInfo);
@@ -133,6 +156,8 @@ Result CreateApplicationArea(ApplicationAreaCreateInfo const& createInfo)
 
 Result WriteApplicationArea(const void* data, uint32_t size, const TagId* tagId)
 {
+    CallProfiler profiler(NFPII_CALL_WRITE_APPLICATION_AREA);
+
     DEBUG_FUNCTION_LINE("nn::nfp::WriteApplicationArea size %u", size);
 
     return tagManager.WriteApplicationArea(data, size, tagId);
@@ -140,6 +165,8 @@ Result WriteApplicationArea(const void* data, uint32_t size, const TagId* tagId)
 
 Result OpenApplicationArea(uint32_t id)
 {
+    CallProfiler profiler(NFPII_CALL_OPEN_APPLICATION_AREA);
+
     DEBUG_FUNCTION_LINE("nn::nfp::OpenApplicationArea");
 
     return tagManager.OpenApplicationArea(id);
@@ -147,6 +174,8 @@ Result OpenApplicationArea(uint32_t id)
 
 Result ReadApplicationArea(void* outData, uint32_t size)
 {
+    CallProfiler profiler(NFPII_CALL_READ_APPLICATION_AREA);
+
     DEBUG_FUNCTION_LINE("nn::nfp::ReadApplicationArea size %d", size);
 
     return tagManager.ReadApplicationArea(outData, size);
@@ -161,6 +190,8 @@ Result DeleteApplicationArea()
 
 Result GetTagInfo(TagInfo* outTagInfo)
 {
+    CallProfiler profiler(NFPII_CALL_GET_TAG_INFO);
+
     DEBUG_FUNCTION_LINE("nn::nfp::GetTagInfo");
 
     return tagManager.GetTagInfo(outTagInfo);
@@ -168,6 +199,8 @@ Result GetTagInfo(TagInfo* outTagInfo)
 
 Result GetNfpCommonInfo(CommonInfo* outCommonInfo)
 {
+    CallProfiler profiler(NFPII_CALL_GET_NFP_COMMON_INFO);
+
     DEBUG_FUNCTION_LINE("nn::nfp::GetNfpCommonInfo");
 
     return tagManager.GetNfpCommonInfo(outCommonInfo);
@@ -175,6 +208,8 @@ Result GetNfpCommonInfo(CommonInfo* outCommonInfo)
 
 Result GetNfpRegisterInfo(RegisterInfo* outRegisterInfo)
 {
+    CallProfiler profiler(NFPII_CALL_GET_NFP_REGISTER_INFO);
+
     DEBUG_FUNCTION_LINE("nn::nfp::GetNfpRegisterInfo");
 
     return tagManager.GetNfpRegisterInfo(outRegisterInfo);
@@ -189,6 +224,8 @@ Result DeleteNfpRegisterInfo()
 
 Result GetNfpReadOnlyInfo(ReadOnlyInfo* outReadOnlyInfo)
 {
+    CallProfiler profiler(NFPII_CALL_GET_NFP_READ_ONLY_INFO);
+
     DEBUG_FUNCTION_LINE("nn::nfp::GetNfpReadOnlyInfo");
     
     return tagManager.GetNfpReadOnlyInfo(outReadOnlyInfo);
@@ -196,6 +233,8 @@ Result GetNfpReadOnlyInfo(ReadOnlyInfo* outReadOnlyInfo)
 
 Result GetNfpRomInfo(RomInfo* outRomInfo)
 {
+    CallProfiler profiler(NFPII_CALL_GET_NFP_ROM_INFO);
+
     DEBUG_FUNCTION_LINE("nn::nfp::GetNfpRomInfo");
 
     return tagManager.GetNfpRomInfo(outRomInfo);
@@ -203,6 +242,8 @@ Result GetNfpRomInfo(RomInfo* outRomInfo)
 
 Result GetNfpAdminInfo(AdminInfo* outAdminInfo)
 {
+    CallProfiler profiler(NFPII_CALL_GET_NFP_ADMIN_INFO);
+
     DEBUG_FUNCTION_LINE("nn::nfp::GetNfpAdminInfo");
 
     return tagManager.GetNfpAdminInfo(outAdminInfo);
@@ -306,11 +347,11 @@ Result ReadAllBackupSaveData(void* param_1, void* param_2)
         return NFP_INVALID_PARAM;
     }
 
-    if (((uint32_t)param_1 & 63) != 0) {
+    if (((uintptr_t)param_1 & 63) != 0) {
         return NFP_INVALID_ALIGNMENT;
     }
 
-    if (((uint32_t)param_2 & 63) != 0) {
+    if (((uintptr_t)param_2 & 63) != 0) {
         return NFP_INVALID_ALIGNMENT;
     }
 
@@ -373,7 +414,7 @@ Result GetCharacterImage(void* buffer, uint32_t size, uint32_t)
         return NFP_INVALID_PARAM;
     }
 
-    if (((uint32_t)buffer & 63) != 0) {
+    if (((uintptr_t)buffer & 63) != 0) {
         return NFP_INVALID_ALIGNMENT;
     }
 
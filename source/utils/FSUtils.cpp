@@ -1,6 +1,10 @@
 #include "FSUtils.hpp"
+#include "stats.h"
 #include <debug/logger.h>
 
+#include <cstring>
+#include <malloc.h>
+
 int FSUtils::Initialize()
 {
     if (clientHandle >= 0) {
@@ -40,39 +44,33 @@ int FSUtils::Finalize()
 }
 
 int FSUtils::WriteToFile(const char* path, const void* data, uint32_t size)
+{
+    return WriteToFile(path, "wb", data, size);
+}
+
+int FSUtils::AppendToFile(const char* path, const void* data, uint32_t size)
+{
+    return WriteToFile(path, "ab", data, size);
+}
+
+int FSUtils::WriteToFile(const char* path, const char* mode, const void* data, uint32_t size)
 {
     if (clientHandle < 0) {
         return clientHandle;
     }
 
+    StatsIncrement(NFPII_STAT_FS_WRITES);
+
     FSAFileHandle fileHandle;
-    FSError err = FSAOpenFileEx(clientHandle, path, "wb", (FSMode) 0x666, FS_OPEN_FLAG_NONE, 0, &fileHandle);
+    StatsIncrement(NFPII_STAT_FS_IPC_CALLS);
+    FSError err = FSAOpenFileEx(clientHandle, path, mode, (FSMode) 0x666, FS_OPEN_FLAG_NONE, 0, &fileHandle);
     if (err < 0) {
         return err;
     }
 
-    __attribute__((aligned(0x40))) uint8_t buf[0x40];
-
-    uint32_t bytesWritten = 0;
-    while (bytesWritten < size) {
-        uint32_t toWrite = size - bytesWritten;
-        if (toWrite > sizeof(buf)) {
-            toWrite = sizeof(buf); 
-        }
-
-        memcpy(buf, (uint8_t*) data + bytesWritten, toWrite);
-        err = FSAWriteFile(clientHandle, buf, 1, toWrite, fileHandle, 0);
-        if (err < 0) {
-            break;
-        }
-
-        bytesWritten += err;
-
-        if ((uint32_t) err != toWrite) {
-            break;
-        }
-    }
+    int bytesWritten = Transfer(fileHandle, (uint8_t*) data, size, true);
 
+    StatsIncrement(NFPII_STAT_FS_IPC_CALLS);
     FSACloseFile(clientHandle, fileHandle);
     return bytesWritten;
 }
@@ -83,34 +81,113 @@ int FSUtils::ReadFromFile(const char* path, void* data, uint32_t size)
         return clientHandle;
     }
 
+    StatsIncrement(NFPII_STAT_FS_READS);
+
     FSAFileHandle fileHandle;
+    StatsIncrement(NFPII_STAT_FS_IPC_CALLS);
     FSError err = FSAOpenFileEx(clientHandle, path, "rb", (FSMode) 0x666, FS_OPEN_FLAG_NONE, 0, &fileHandle);
     if (err < 0) {
         return err;
     }
 
-    __attribute__((aligned(0x40))) uint8_t buf[0x40];
+    int bytesRead = Transfer(fileHandle, (uint8_t*) data, size, false);
+
+    StatsIncrement(NFPII_STAT_FS_IPC_CALLS);
+    FSACloseFile(clientHandle, fileHandle);
+    return bytesRead;
+}
+
+int FSUtils::Transfer(FSAFileHandle fileHandle, uint8_t* data, uint32_t size, bool write)
+{
+    // FSA needs 0x40 aligned buffers
+    // Aligned buffers can be used directly, otherwise bounce everything through a buffer
+    // large enough for the whole transfer, so this usually only needs a single call
+    __attribute__((aligned(0x40))) uint8_t stackBuf[0x40];
+    uint8_t* buf = data;
+    uint32_t bufSize = size;
+    bool bounce = ((uintptr_t) data & 0x3f) != 0;
+    if (bounce) {
+        buf = (uint8_t*) memalign(0x40, size);
+        if (!buf) {
+            // Fall back to transferring in small chunks
+            buf = stackBuf;
+            bufSize = sizeof(stackBuf);
+        }
+    }
 
-    uint32_t bytesRead = 0;
-    while (bytesRead < size) {
-        uint32_t toRead = size - bytesRead;
-        if (toRead > sizeof(buf)) {
-            toRead = sizeof(buf); 
+    uint32_t bytesTransferred = 0;
+    while (bytesTransferred < size) {
+        uint32_t toTransfer = size - bytesTransferred;
+        if (toTransfer > bufSize) {
+            toTransfer = bufSize;
+        }
+
+        uint8_t* chunk = (bounce && buf == stackBuf) ? buf : buf + bytesTransferred;
+
+        FSError err;
+        StatsIncrement(NFPII_STAT_FS_IPC_CALLS);
+        if (write) {
+            if (bounce) {
+                memcpy(chunk, data + bytesTransferred, toTransfer);
+            }
+
+            err = FSAWriteFile(clientHandle, chunk, 1, toTransfer, fileHandle, 0);
+        } else {
+            err = FSAReadFile(clientHandle, chunk, 1, toTransfer, fileHandle, 0);
+            if (err > 0 && bounce) {
+                memcpy(data + bytesTransferred, chunk, err);
+            }
         }
 
-        err = FSAReadFile(clientHandle, buf, 1, toRead, fileHandle, 0);
         if (err < 0) {
             break;
         }
 
-        memcpy((uint8_t*) data + bytesRead, buf, err);
-        bytesRead += err;
+        bytesTransferred += err;
 
-        if ((uint32_t) err != toRead) {
+        if ((uint32_t) err != toTransfer) {
             break;
         }
     }
 
-    FSACloseFile(clientHandle, fileHandle);
-    return bytesRead;
+    if (bounce && buf != stackBuf) {
+        free(buf);
+    }
+
+    return bytesTransferred;
+}
+
+int FSUtils::GetStat(const char* path, FSAStat* outStat)
+{
+    if (clientHandle < 0) {
+        return clientHandle;
+    }
+
+    StatsIncrement(NFPII_STAT_FS_IPC_CALLS);
+    return FSAGetStat(clientHandle, path, outStat);
+}
+
+int FSUtils::Remove(const char* path)
+{
+    if (clientHandle < 0) {
+        return clientHandle;
+    }
+
+    StatsIncrement(NFPII_STAT_FS_IPC_CALLS);
+    return FSARemove(clientHandle, path);
+}
+
+int FSUtils::MakeDir(const char* path)
+{
+    if (clientHandle < 0) {
+        return clientHandle;
+    }
+
+    StatsIncrement(NFPII_STAT_FS_IPC_CALLS);
+    FSError err = FSAMakeDir(clientHandle, path, (FSMode) 0x666);
+    if (err == FS_ERROR_ALREADY_EXISTS) {
+        return 0;
+    }
+
+    return err;
 }
@@ -9,7 +9,14 @@ public:
 
     static int WriteToFile(const char* path, const void* data, uint32_t size);
     static int ReadFromFile(const char* path, void* data, uint32_t size);
+    static int AppendToFile(const char* path, const void* data, uint32_t size);
+    static int GetStat(const char* path, FSAStat* outStat);
+    static int Remove(const char* path);
+    static int MakeDir(const char* path);
 
 private:
+    static int WriteToFile(const char* path, const char* mode, const void* data, uint32_t size);
+    static int Transfer(FSAFileHandle fileHandle, uint8_t* data, uint32_t size, bool write);
+
     static inline FSAClientHandle clientHandle = -1;
 };
@@ -0,0 +1,94 @@
+#include "stats.h"
+
+#include <coreinit/atomic64.h>
+
+static volatile uint64_t stats[NFPII_STAT_MAX];
+
+static struct {
+    volatile uint64_t calls;
+    volatile uint64_t totalTimeUs;
+    volatile uint64_t maxTimeUs;
+} callProfiles[NFPII_CALL_MAX];
+
+void StatsIncrement(NfpiiStatistic stat)
+{
+    StatsAdd(stat, 1);
+}
+
+void StatsAdd(NfpiiStatistic stat, uint64_t value)
+{
+    if (stat >= NFPII_STAT_MAX) {
+        return;
+    }
+
+    OSAddAtomic64(&stats[stat], value);
+}
+
+void StatsSetMax(NfpiiStatistic stat, uint64_t value)
+{
+    if (stat >= NFPII_STAT_MAX) {
+        return;
+    }
+
+    uint64_t current = OSGetAtomic64(&stats[stat]);
+    while (value > current) {
+        if (OSCompareAndSwapAtomic64(&stats[stat], current, value)) {
+            break;
+        }
+
+        current = OSGetAtomic64(&stats[stat]);
+    }
+}
+
+uint64_t StatsGet(NfpiiStatistic stat)
+{
+    if (stat >= NFPII_STAT_MAX) {
+        return 0;
+    }
+
+    return OSGetAtomic64(&stats[stat]);
+}
+
+void StatsRecordCall(NfpiiCall call, uint64_t us)
+{
+    if (call >= NFPII_CALL_MAX) {
+        return;
+    }
+
+    OSAddAtomic64(&callProfiles[call].calls, 1);
+    OSAddAtomic64(&callProfiles[call].totalTimeUs, us);
+
+    uint64_t current = OSGetAtomic64(&callProfiles[call].maxTimeUs);
+    while (us > current) {
+        if (OSCompareAndSwapAtomic64(&callProfiles[call].maxTimeUs, current, us)) {
+            break;
+        }
+
+        current = OSGetAtomic64(&callProfiles[call].maxTimeUs);
+    }
+}
+
+bool StatsGetCallProfile(NfpiiCall call, NfpiiCallProfile* outProfile)
+{
+    if (call >= NFPII_CALL_MAX || !outProfile) {
+        return false;
+    }
+
+    outProfile->calls = OSGetAtomic64(&callProfiles[call].calls);
+    outProfile->totalTimeUs = OSGetAtomic64(&callProfiles[call].totalTimeUs);
+    outProfile->maxTimeUs = OSGetAtomic64(&callProfiles[call].maxTimeUs);
+    return true;
+}
+
+void StatsReset(void)
+{
+    for (int i = 0; i < NFPII_STAT_MAX; i++) {
+        OSSetAtomic64(&stats[i], 0);
+    }
+
+    for (int i = 0; i < NFPII_CALL_MAX; i++) {
+        OSSetAtomic64(&callProfiles[i].calls, 0);
+        OSSetAtomic64(&callProfiles[i].totalTimeUs, 0);
+        OSSetAtomic64(&callProfiles[i].maxTimeUs, 0);
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+#include <nfpii.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*  Simple counters to check how the module behaves in real sessions.
+    All counters are updated atomically and can be read from any thread.
+    They get reset whenever a new application starts. */
+
+void StatsIncrement(NfpiiStatistic stat);
+
+void StatsAdd(NfpiiStatistic stat, uint64_t value);
+
+void StatsSetMax(NfpiiStatistic stat, uint64_t value);
+
+uint64_t StatsGet(NfpiiStatistic stat);
+
+// Records the latency of a single nn::nfp call
+void StatsRecordCall(NfpiiCall call, uint64_t us);
+
+bool StatsGetCallProfile(NfpiiCall call, NfpiiCallProfile* outProfile);
+
+void StatsReset(void);
+
+#ifdef __cplusplus
+}
+#endif